@@ -0,0 +1,50 @@
+#version 430 core
+
+uniform sampler2D texture_diffuse;
+uniform usampler2D tileIndices;
+
+uniform int tilesPerRow;
+uniform float uvTileSize;
+uniform int alphaMode;
+
+// Texels a draw keeps, see SpriteRenderer::AlphaMode.
+const int opaqueTexels = 0;
+const int translucentTexels = 1;
+
+in vec2 cellPosition;
+
+out vec4 FragColor;
+
+const uint emptyCell = 0xFFFFu;
+const uint flipX = 1u;
+const uint flipY = 2u;
+const uint rotate90 = 4u;
+
+void main() {
+    ivec2 cell = ivec2(floor(cellPosition));
+    uint value = texelFetch(tileIndices, cell, 0).r;
+    if (value == emptyCell)
+        discard;
+
+    uint tileIndex = value & 0x1FFFu;
+    uint flags = value >> 13;
+
+    // Undo the sprite transform: the inverse of flip-then-rotate is rotate back, then flip.
+    vec2 local = vec2(fract(cellPosition.x), 1.0 - fract(cellPosition.y)) - vec2(0.5);
+    if ((flags & rotate90) != 0u)
+        local = vec2(local.y, -local.x);
+    if ((flags & flipX) != 0u)
+        local.x = -local.x;
+    if ((flags & flipY) != 0u)
+        local.y = -local.y;
+    vec2 uv = clamp(local + vec2(0.5), vec2(0.001), vec2(0.999));
+
+    vec2 tileCoord = vec2(float(int(tileIndex) % tilesPerRow), float(int(tileIndex) / tilesPerRow));
+    vec2 texCoord = vec2((uv.x + tileCoord.x) * uvTileSize, 1.0 - uvTileSize * (1.0 - uv.y + tileCoord.y));
+
+    FragColor = texture(texture_diffuse, texCoord);
+
+    bool isOpaque = FragColor.a >= 1.0;
+    if (FragColor.a <= 0.0 || (alphaMode == opaqueTexels && !isOpaque) || (alphaMode == translucentTexels && isOpaque))
+        discard;
+}
@@ -0,0 +1,29 @@
+#version 430 core
+
+layout(location = 0) in vec3 position;
+
+layout(std140, binding = 0) uniform TransformationMatrices {
+    mat4 projection;
+    mat4 view;
+};
+
+layout(std140, binding = 1) uniform RenderLayers {
+    vec4 layerOffsets[16];
+};
+
+uniform mat4 model;
+uniform ivec2 layerSize;
+uniform int renderLayer;
+
+// Position in cell units: x grows to the right, y grows downwards from the top row of the layer.
+out vec2 cellPosition;
+
+void main() {
+    vec2 corner = position.xy + vec2(0.5, 0.5);
+    vec2 localPosition = vec2(-0.5, 0.5) + corner * vec2(layerSize);
+    cellPosition = vec2(corner.x * layerSize.x, (1.0 - corner.y) * layerSize.y);
+
+    vec4 worldPosition = model * vec4(localPosition, 0.0, 1.0);
+    worldPosition.xy += layerOffsets[renderLayer].xy;
+    gl_Position = projection * view * worldPosition;
+}
@@ -0,0 +1,54 @@
+#version 430 core
+
+uniform sampler2DArray texture_diffuse;
+uniform usampler2D tileIndices;
+uniform int alphaMode;
+
+// Texels a draw keeps, see SpriteRenderer::AlphaMode.
+const int opaqueTexels = 0;
+const int translucentTexels = 1;
+
+// TileOpacity of every tile of the bound material, see SpriteRenderer::tileOpacityBlockBinding.
+layout(std430, binding = 7) readonly buffer TileOpacities {
+    uint tileOpacities[];
+};
+const uint translucentTile = 2u;
+
+in vec2 cellPosition;
+
+out vec4 FragColor;
+
+const uint emptyCell = 0xFFFFu;
+const uint flipX = 1u;
+const uint flipY = 2u;
+const uint rotate90 = 4u;
+
+void main() {
+    ivec2 cell = ivec2(floor(cellPosition));
+    uint value = texelFetch(tileIndices, cell, 0).r;
+    if (value == emptyCell)
+        discard;
+
+    uint tileIndex = value & 0x1FFFu;
+    uint flags = value >> 13;
+
+    // Undo the sprite transform: the inverse of flip-then-rotate is rotate back, then flip.
+    vec2 local = vec2(fract(cellPosition.x), 1.0 - fract(cellPosition.y)) - vec2(0.5);
+    if ((flags & rotate90) != 0u)
+        local = vec2(local.y, -local.x);
+    if ((flags & flipX) != 0u)
+        local.x = -local.x;
+    if ((flags & flipY) != 0u)
+        local.y = -local.y;
+
+    // fract() jumps at cell edges, the gradient of the unwrapped position keeps the mip level steady across them.
+    FragColor = textureGrad(texture_diffuse, vec3(local + vec2(0.5), float(tileIndex)), dFdx(cellPosition), dFdy(cellPosition));
+
+    // Filtering and mipmaps give opaque and alpha-tested tiles partial texels at their edges, those are cut at half
+    // coverage. Only translucent tiles hand their partial texels to the blended pass.
+    bool isTranslucentTile = tileOpacities[tileIndex] == translucentTile;
+    bool isOpaque = FragColor.a >= (isTranslucentTile ? 1.0 : 0.5);
+    if (FragColor.a <= 0.0 || (alphaMode == opaqueTexels && !isOpaque)
+        || (alphaMode == translucentTexels && (isOpaque || !isTranslucentTile)))
+        discard;
+}
@@ -1,26 +1,39 @@
 #version 430 core
 
 uniform sampler2D texture_diffuse;
+// Indexed materials, one palette per row.
+uniform usampler2D texture_indices;
+uniform sampler2D palettes;
 
 out vec4 FragColor;
 
-uniform int tileSize;
-uniform int tileMapSize;
+uniform int alphaMode;
+
+// Texels a draw keeps, see SpriteRenderer::AlphaMode.
+const int opaqueTexels = 0;
+const int translucentTexels = 1;
 
 in VS_OUT {
     vec2 texCoord;
-    flat ivec2 tileCoord;
-    float uvTileSize;
+    flat vec4 tileRect;
+    flat int paletteRow;
 } fs_in;
 
 void main() {
-    vec2 minTexCoord = fs_in.tileCoord * fs_in.uvTileSize;
-    vec2 maxTexCoord = minTexCoord + fs_in.uvTileSize;
-
-    vec2 clampedTexCoord = fs_in.texCoord;
-    clampedTexCoord.x = clamp(clampedTexCoord.x, minTexCoord.x + 0.001, maxTexCoord.x - 0.001);
-    clampedTexCoord.y = clamp(clampedTexCoord.y,  1 - (maxTexCoord.y - 0.001), 1 - (minTexCoord.y + 0.001));
-
-    FragColor = texture(texture_diffuse, clampedTexCoord);
-
+    // Half a texel inside the rect, so nothing of the neighbouring tiles is sampled.
+    bool isIndexed = fs_in.paletteRow >= 0;
+    ivec2 atlasSize = isIndexed ? textureSize(texture_indices, 0) : textureSize(texture_diffuse, 0);
+    vec2 halfTexel = 0.5 / vec2(atlasSize);
+    vec2 clampedTexCoord = clamp(fs_in.texCoord, fs_in.tileRect.xy + halfTexel, fs_in.tileRect.zw - halfTexel);
+
+    if (isIndexed) {
+        uint index = texture(texture_indices, clampedTexCoord).r;
+        FragColor = texelFetch(palettes, ivec2(int(index), fs_in.paletteRow), 0);
+    } else {
+        FragColor = texture(texture_diffuse, clampedTexCoord);
+    }
+
+    bool isOpaque = FragColor.a >= 1.0;
+    if (FragColor.a <= 0.0 || (alphaMode == opaqueTexels && !isOpaque) || (alphaMode == translucentTexels && isOpaque))
+        discard;
 }
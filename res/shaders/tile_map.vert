@@ -2,35 +2,40 @@
 
 layout(location = 0) in vec3 position;
 layout(location = 1) in mat4 transform;
-layout(location = 5) in ivec2 tileCoord;
+// Tile index, and the render layer with the sprite's palette in the bits above it.
+layout(location = 5) in ivec2 tile;
 
 layout(std140, binding = 0) uniform TransformationMatrices {
     mat4 projection;
     mat4 view;
 };
 
-uniform int tileSize;
-uniform int tileMapSize;
+layout(std140, binding = 1) uniform RenderLayers {
+    vec4 layerOffsets[16];
+};
+
+layout(std430, binding = 2) readonly buffer TileRects {
+    // Min and max texture coordinates of each tile of the bound material.
+    vec4 tileRects[];
+};
+
+// Palette row of an indexed material, -1 for colour materials.
+uniform int materialPalette;
 
 out VS_OUT {
     vec2 texCoord;
-    flat ivec2 tileCoord;
-    float uvTileSize;
+    flat vec4 tileRect;
+    flat int paletteRow;
 } vs_out;
 
 void main() {
-    vs_out.tileCoord = tileCoord;
-    vs_out.uvTileSize = 1.f / (tileMapSize/tileSize);
-
-    gl_Position = projection * view * transform * vec4(position, 1.0);
-
-    vec2 fTileCoord;
-    fTileCoord.x = float(tileCoord.x);
-    fTileCoord.y = float(-tileCoord.y);
+    int palette = tile.y >> 8;
+    vs_out.paletteRow = materialPalette < 0 ? -1 : (palette != 0 ? palette : materialPalette);
 
-    vec2 texCoord = position.xy + vec2(0.5, 0.5) + fTileCoord;
-    texCoord.y = 1 - texCoord.y;
+    vs_out.tileRect = tileRects[tile.x];
+    vs_out.texCoord = mix(vs_out.tileRect.xy, vs_out.tileRect.zw, position.xy + vec2(0.5));
 
-    vs_out.texCoord = texCoord * vs_out.uvTileSize;
-    vs_out.texCoord.y = 1 - vs_out.texCoord.y;
+    vec4 worldPosition = transform * vec4(position, 1.0);
+    worldPosition.xy += layerOffsets[tile.y & 0xFF].xy;
+    gl_Position = projection * view * worldPosition;
 }
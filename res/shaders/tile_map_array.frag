@@ -0,0 +1,45 @@
+#version 430 core
+
+// One layer per tile, so the tile's own edges clamp the lookup and nothing bleeds in from its neighbours.
+uniform sampler2DArray texture_diffuse;
+// Indexed materials, one palette per row.
+uniform usampler2DArray texture_indices;
+uniform sampler2D palettes;
+
+out vec4 FragColor;
+
+uniform int alphaMode;
+
+// Texels a draw keeps, see SpriteRenderer::AlphaMode.
+const int opaqueTexels = 0;
+const int translucentTexels = 1;
+
+// TileOpacity of every tile of the bound material, see SpriteRenderer::tileOpacityBlockBinding.
+layout(std430, binding = 7) readonly buffer TileOpacities {
+    uint tileOpacities[];
+};
+const uint translucentTile = 2u;
+
+in VS_OUT {
+    vec2 tileUV;
+    flat int tileLayer;
+    flat int paletteRow;
+} fs_in;
+
+void main() {
+    vec3 tileCoord = vec3(fs_in.tileUV, float(fs_in.tileLayer));
+    if (fs_in.paletteRow >= 0) {
+        uint index = texture(texture_indices, tileCoord).r;
+        FragColor = texelFetch(palettes, ivec2(int(index), fs_in.paletteRow), 0);
+    } else {
+        FragColor = texture(texture_diffuse, tileCoord);
+    }
+
+    // Filtering and mipmaps give opaque and alpha-tested tiles partial texels at their edges, those are cut at half
+    // coverage. Only translucent tiles hand their partial texels to the blended pass.
+    bool isTranslucentTile = tileOpacities[fs_in.tileLayer] == translucentTile;
+    bool isOpaque = FragColor.a >= (isTranslucentTile ? 1.0 : 0.5);
+    if (FragColor.a <= 0.0 || (alphaMode == opaqueTexels && !isOpaque)
+        || (alphaMode == translucentTexels && (isOpaque || !isTranslucentTile)))
+        discard;
+}
@@ -0,0 +1,42 @@
+#version 430 core
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in mat4 transform;
+// Tile index, and the render layer with the sprite's palette in the bits above it.
+layout(location = 5) in ivec2 tile;
+
+layout(std140, binding = 0) uniform TransformationMatrices {
+    mat4 projection;
+    mat4 view;
+};
+
+layout(std140, binding = 1) uniform RenderLayers {
+    vec4 layerOffsets[16];
+};
+
+layout(std430, binding = 2) readonly buffer TileRects {
+    // Min and max texture coordinates of each tile of the bound material.
+    vec4 tileRects[];
+};
+
+// Palette row of an indexed material, -1 for colour materials.
+uniform int materialPalette;
+
+out VS_OUT {
+    vec2 tileUV;
+    flat int tileLayer;
+    flat int paletteRow;
+} vs_out;
+
+void main() {
+    int palette = tile.y >> 8;
+    vs_out.paletteRow = materialPalette < 0 ? -1 : (palette != 0 ? palette : materialPalette);
+
+    vec4 tileRect = tileRects[tile.x];
+    vs_out.tileUV = mix(tileRect.xy, tileRect.zw, position.xy + vec2(0.5));
+    vs_out.tileLayer = tile.x;
+
+    vec4 worldPosition = transform * vec4(position, 1.0);
+    worldPosition.xy += layerOffsets[tile.y & 0xFF].xy;
+    gl_Position = projection * view * worldPosition;
+}
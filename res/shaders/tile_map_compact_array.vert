@@ -0,0 +1,59 @@
+#version 430 core
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 instancePosition;
+layout(location = 2) in vec2 instanceScale;
+layout(location = 3) in uint tileIndex;
+layout(location = 4) in uint flags;
+layout(location = 5) in uint layer;
+
+layout(std140, binding = 0) uniform TransformationMatrices {
+    mat4 projection;
+    mat4 view;
+};
+
+layout(std140, binding = 1) uniform RenderLayers {
+    vec4 layerOffsets[16];
+};
+
+layout(std430, binding = 2) readonly buffer TileRects {
+    // Min and max texture coordinates of each tile of the bound material.
+    vec4 tileRects[];
+};
+
+// Palette row of an indexed material, -1 for colour materials.
+uniform int materialPalette;
+
+out VS_OUT {
+    vec2 tileUV;
+    flat int tileLayer;
+    flat int paletteRow;
+} vs_out;
+
+const uint flipX = 1u;
+const uint flipY = 2u;
+const uint rotate90 = 4u;
+// The sprite's palette, 0 keeps the material's own.
+const uint paletteShift = 3u;
+
+void main() {
+    int palette = int(flags >> paletteShift);
+    vs_out.paletteRow = materialPalette < 0 ? -1 : (palette != 0 ? palette : materialPalette);
+
+    vec4 tileRect = tileRects[tileIndex];
+    vs_out.tileUV = mix(tileRect.xy, tileRect.zw, position.xy + vec2(0.5));
+    vs_out.tileLayer = int(tileIndex);
+
+    vec2 scale = instanceScale;
+    if ((flags & flipX) != 0u)
+        scale.x = -scale.x;
+    if ((flags & flipY) != 0u)
+        scale.y = -scale.y;
+
+    vec2 corner = position.xy * scale;
+    if ((flags & rotate90) != 0u)
+        corner = vec2(-corner.y, corner.x);
+
+    vec3 worldPosition = instancePosition + vec3(corner + layerOffsets[layer].xy, 0.0);
+    gl_Position = projection * view * vec4(worldPosition, 1.0);
+}
@@ -0,0 +1,69 @@
+#version 430 core
+
+layout(location = 0) in vec3 position;
+// Visible slot written by cull_sprites_compact.comp.
+layout(location = 1) in uint slot;
+
+layout(std140, binding = 0) uniform TransformationMatrices {
+    mat4 projection;
+    mat4 view;
+};
+
+layout(std140, binding = 1) uniform RenderLayers {
+    vec4 layerOffsets[16];
+};
+
+layout(std430, binding = 2) readonly buffer TileRects {
+    // Min and max texture coordinates of each tile of the bound material.
+    vec4 tileRects[];
+};
+
+// SpriteInstance, five words each: position, two half float scales, then tile index, flags and layer.
+layout(std430, binding = 3) readonly buffer Instances {
+    uint instanceWords[];
+};
+
+// Palette row of an indexed material, -1 for colour materials.
+uniform int materialPalette;
+
+out VS_OUT {
+    vec2 tileUV;
+    flat int tileLayer;
+    flat int paletteRow;
+} vs_out;
+
+const uint flipX = 1u;
+const uint flipY = 2u;
+const uint rotate90 = 4u;
+// The sprite's palette, 0 keeps the material's own.
+const uint paletteShift = 3u;
+
+void main() {
+    uint base = slot * 5u;
+    vec3 instancePosition = vec3(uintBitsToFloat(instanceWords[base]), uintBitsToFloat(instanceWords[base + 1u]),
+                                 uintBitsToFloat(instanceWords[base + 2u]));
+    vec2 instanceScale = unpackHalf2x16(instanceWords[base + 3u]);
+    uint tileIndex = instanceWords[base + 4u] & 0xFFFFu;
+    uint flags = (instanceWords[base + 4u] >> 16u) & 0xFFu;
+    uint layer = instanceWords[base + 4u] >> 24u;
+
+    int palette = int(flags >> paletteShift);
+    vs_out.paletteRow = materialPalette < 0 ? -1 : (palette != 0 ? palette : materialPalette);
+
+    vec4 tileRect = tileRects[tileIndex];
+    vs_out.tileUV = mix(tileRect.xy, tileRect.zw, position.xy + vec2(0.5));
+    vs_out.tileLayer = int(tileIndex);
+
+    vec2 scale = instanceScale;
+    if ((flags & flipX) != 0u)
+        scale.x = -scale.x;
+    if ((flags & flipY) != 0u)
+        scale.y = -scale.y;
+
+    vec2 corner = position.xy * scale;
+    if ((flags & rotate90) != 0u)
+        corner = vec2(-corner.y, corner.x);
+
+    vec3 worldPosition = instancePosition + vec3(corner + layerOffsets[layer].xy, 0.0);
+    gl_Position = projection * view * vec4(worldPosition, 1.0);
+}
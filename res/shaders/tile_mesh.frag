@@ -0,0 +1,44 @@
+#version 430 core
+
+uniform sampler2D texture_diffuse;
+
+uniform int tilesPerRow;
+uniform float uvTileSize;
+uniform int alphaMode;
+
+// Texels a draw keeps, see SpriteRenderer::AlphaMode.
+const int opaqueTexels = 0;
+const int translucentTexels = 1;
+
+in vec2 vertexCellPosition;
+flat in uint vertexCell;
+
+out vec4 FragColor;
+
+const uint flipX = 1u;
+const uint flipY = 2u;
+const uint rotate90 = 4u;
+
+void main() {
+    uint tileIndex = vertexCell & 0x1FFFu;
+    uint flags = vertexCell >> 13;
+
+    // Merged quads span several cells, taking the fractional part repeats the tile across them.
+    vec2 local = vec2(fract(vertexCellPosition.x), 1.0 - fract(vertexCellPosition.y)) - vec2(0.5);
+    if ((flags & rotate90) != 0u)
+        local = vec2(local.y, -local.x);
+    if ((flags & flipX) != 0u)
+        local.x = -local.x;
+    if ((flags & flipY) != 0u)
+        local.y = -local.y;
+    vec2 uv = clamp(local + vec2(0.5), vec2(0.001), vec2(0.999));
+
+    vec2 tileCoord = vec2(float(int(tileIndex) % tilesPerRow), float(int(tileIndex) / tilesPerRow));
+    vec2 texCoord = vec2((uv.x + tileCoord.x) * uvTileSize, 1.0 - uvTileSize * (1.0 - uv.y + tileCoord.y));
+
+    FragColor = texture(texture_diffuse, texCoord);
+
+    bool isOpaque = FragColor.a >= 1.0;
+    if (FragColor.a <= 0.0 || (alphaMode == opaqueTexels && !isOpaque) || (alphaMode == translucentTexels && isOpaque))
+        discard;
+}
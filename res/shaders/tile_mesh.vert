@@ -0,0 +1,30 @@
+#version 430 core
+
+layout(location = 0) in vec2 cellPosition;
+layout(location = 1) in uint cell;
+
+layout(std140, binding = 0) uniform TransformationMatrices {
+    mat4 projection;
+    mat4 view;
+};
+
+layout(std140, binding = 1) uniform RenderLayers {
+    vec4 layerOffsets[16];
+};
+
+uniform mat4 model;
+uniform ivec2 layerSize;
+uniform int renderLayer;
+
+out vec2 vertexCellPosition;
+flat out uint vertexCell;
+
+void main() {
+    vertexCellPosition = cellPosition;
+    vertexCell = cell;
+
+    vec2 localPosition = vec2(cellPosition.x - 0.5, float(layerSize.y) + 0.5 - cellPosition.y);
+    vec4 worldPosition = model * vec4(localPosition, 0.0, 1.0);
+    worldPosition.xy += layerOffsets[renderLayer].xy;
+    gl_Position = projection * view * worldPosition;
+}
@@ -0,0 +1,48 @@
+#version 430 core
+
+uniform sampler2DArray texture_diffuse;
+uniform int alphaMode;
+
+// Texels a draw keeps, see SpriteRenderer::AlphaMode.
+const int opaqueTexels = 0;
+const int translucentTexels = 1;
+
+// TileOpacity of every tile of the bound material, see SpriteRenderer::tileOpacityBlockBinding.
+layout(std430, binding = 7) readonly buffer TileOpacities {
+    uint tileOpacities[];
+};
+const uint translucentTile = 2u;
+
+in vec2 vertexCellPosition;
+flat in uint vertexCell;
+
+out vec4 FragColor;
+
+const uint flipX = 1u;
+const uint flipY = 2u;
+const uint rotate90 = 4u;
+
+void main() {
+    uint tileIndex = vertexCell & 0x1FFFu;
+    uint flags = vertexCell >> 13;
+
+    // Merged quads span several cells, taking the fractional part repeats the tile across them.
+    vec2 local = vec2(fract(vertexCellPosition.x), 1.0 - fract(vertexCellPosition.y)) - vec2(0.5);
+    if ((flags & rotate90) != 0u)
+        local = vec2(local.y, -local.x);
+    if ((flags & flipX) != 0u)
+        local.x = -local.x;
+    if ((flags & flipY) != 0u)
+        local.y = -local.y;
+
+    // fract() jumps at cell edges, the gradient of the unwrapped position keeps the mip level steady across them.
+    FragColor = textureGrad(texture_diffuse, vec3(local + vec2(0.5), float(tileIndex)), dFdx(vertexCellPosition), dFdy(vertexCellPosition));
+
+    // Filtering and mipmaps give opaque and alpha-tested tiles partial texels at their edges, those are cut at half
+    // coverage. Only translucent tiles hand their partial texels to the blended pass.
+    bool isTranslucentTile = tileOpacities[tileIndex] == translucentTile;
+    bool isOpaque = FragColor.a >= (isTranslucentTile ? 1.0 : 0.5);
+    if (FragColor.a <= 0.0 || (alphaMode == opaqueTexels && !isOpaque)
+        || (alphaMode == translucentTexels && (isOpaque || !isTranslucentTile)))
+        discard;
+}
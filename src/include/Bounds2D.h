@@ -0,0 +1,12 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+struct Bounds2D {
+    glm::vec2 min;
+    glm::vec2 max;
+
+    [[nodiscard]] bool Overlaps(const Bounds2D& other) const {
+        return min.x <= other.max.x && other.min.x <= max.x && min.y <= other.max.y && other.min.y <= max.y;
+    }
+};
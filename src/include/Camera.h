@@ -3,31 +3,32 @@
 
 #include <memory>
 #include <glm/glm.hpp>
-#include <glad/glad.h>
+
+#include "Bounds2D.h"
 
 class Camera {
 private:
     glm::vec3 position;
 
-    GLuint uboTransformMatrices;
-
     float scale;
     glm::vec<2, int> Resolution;
 public:
     Camera();
 
-    ~Camera();
-
     void SetPosition(glm::vec3 newPosition);
 
     [[nodiscard]] glm::mat4 GetCameraProjectionMatrix(glm::vec<2, int> resolution) const;
 
     void UpdateProjection(glm::vec<2, int> resolution);
 
+    // The matrices of the TransformationMatrices block, the renderer uploads them when the frame is drawn.
+    [[nodiscard]] glm::mat4 GetProjectionMatrix() const;
+    [[nodiscard]] glm::mat4 GetViewMatrix() const;
+
     [[nodiscard]] float GetScale() const;
 
-    void SetScale(float scale);
+    // World-space rectangle covered by the last projection.
+    [[nodiscard]] Bounds2D GetVisibleBounds() const;
 
-private:
-    void UpdateView();
+    void SetScale(float scale);
 };
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+// Linear allocator for data that only lives until the end of the frame. Allocation is a pointer bump and
+// Reset() frees everything at once. A frame that outgrows the buffer falls back to the heap and the buffer
+// is grown on the next Reset(), so FrameVectors stop reaching the general purpose allocator once it has grown.
+// Other containers of the frame still allocate, among them SpriteGrid cells that are created and erased as sprites
+// move between them and the SortByKey fallback of the insertion sort.
+class FrameAllocator {
+private:
+    std::unique_ptr<std::byte[]> buffer;
+    size_t capacity;
+    size_t offset;
+
+    std::vector<std::unique_ptr<std::byte[]>> overflowBlocks;
+    size_t overflowBytes;
+    uint32_t overflowCount;
+
+    static thread_local FrameAllocator* currentThreadAllocator;
+
+public:
+    explicit FrameAllocator(size_t capacity);
+
+    FrameAllocator(const FrameAllocator&) = delete;
+    FrameAllocator& operator=(const FrameAllocator&) = delete;
+
+    void* Allocate(size_t size, size_t alignment);
+    void Reset();
+
+    [[nodiscard]] size_t GetUsedBytes() const;
+    [[nodiscard]] size_t GetCapacity() const;
+    [[nodiscard]] uint32_t GetOverflowCount() const;
+
+    // The calling thread's allocator, null on threads that were never bound.
+    static FrameAllocator* Get();
+    static void BindToCurrentThread(FrameAllocator* allocator);
+};
+
+// Allocates from the frame allocator of the thread that created it. Containers created on a thread without one use
+// the heap instead.
+template<typename T>
+class FrameAllocatorAdapter {
+private:
+    FrameAllocator* allocator;
+
+public:
+    using value_type = T;
+
+    FrameAllocatorAdapter() : allocator(FrameAllocator::Get()) {}
+    explicit FrameAllocatorAdapter(FrameAllocator& allocator) : allocator(&allocator) {}
+
+    template<typename U>
+    FrameAllocatorAdapter(const FrameAllocatorAdapter<U>& other) : allocator(other.GetAllocator()) {}
+
+    T* allocate(size_t count) {
+        if (allocator == nullptr)
+            return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(alignof(T))));
+        return static_cast<T*>(allocator->Allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* pointer, size_t) noexcept {
+        if (allocator == nullptr)
+            ::operator delete(pointer, std::align_val_t(alignof(T)));
+    }
+
+    [[nodiscard]] FrameAllocator* GetAllocator() const {
+        return allocator;
+    }
+
+    template<typename U>
+    bool operator==(const FrameAllocatorAdapter<U>& other) const {
+        return allocator == other.GetAllocator();
+    }
+};
+
+template<typename T>
+using FrameVector = std::vector<T, FrameAllocatorAdapter<T>>;
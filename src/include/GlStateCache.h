@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+struct GlStateCallCounts {
+    uint32_t issued = 0;
+    // Calls dropped because the state already had the value.
+    uint32_t redundant = 0;
+};
+
+// Remembers the state the renderer set last and drops calls that would not change it. It only sees the calls made
+// through it, so Reset() has to follow code that binds behind its back, like ImGui or the cull passes. Uniforms belong
+// to their program and survive Reset().
+class GlStateCache {
+public:
+    static constexpr GLuint maxTextureUnits = 8;
+    static constexpr GLuint maxStorageBindings = 8;
+
+private:
+    // Never a GL name, marks state that was not set through the cache.
+    static constexpr GLuint unknownName = ~0u;
+
+    struct StorageBinding {
+        GLuint buffer;
+        GLintptr offset;
+        GLsizeiptr size;
+    };
+
+    GLuint program;
+    GLuint vertexArray;
+    GLuint activeTextureUnit;
+    // GL_TEXTURE_2D and GL_TEXTURE_2D_ARRAY of every unit.
+    std::array<std::array<GLuint, 2>, maxTextureUnits> textures;
+    std::array<StorageBinding, maxStorageBindings> storageBindings;
+    std::optional<bool> isBlendEnabled;
+    std::optional<bool> isDepthMaskEnabled;
+
+    // Last value written to every (program, location), large enough for a mat4.
+    std::unordered_map<uint64_t, std::array<std::byte, sizeof(glm::mat4)>> uniformValues;
+
+    GlStateCallCounts callCounts;
+
+public:
+    GlStateCache();
+
+    void Reset();
+
+    void UseProgram(GLuint newProgram);
+    void BindVertexArray(GLuint newVertexArray);
+    void SetActiveTextureUnit(GLuint unit);
+    // Only GL_TEXTURE_2D and GL_TEXTURE_2D_ARRAY.
+    void BindTexture(GLuint unit, GLenum target, GLuint texture);
+    // A size of 0 binds the whole buffer.
+    void BindStorageBuffer(GLuint binding, GLuint buffer, GLintptr offset = 0, GLsizeiptr size = 0);
+    void SetBlendEnabled(bool isEnabled);
+    void SetDepthMask(bool isEnabled);
+
+    // Records value as the uniform's current one. Returns true if it already was, the write can then be skipped.
+    bool IsUniformUnchanged(GLuint uniformProgram, GLint location, const void* value, size_t size);
+
+    // Counts since the previous call.
+    GlStateCallCounts TakeCallCounts();
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <glad/glad.h>
+
+// Culls compact sprite instances in compute passes. Every instance is tested against the camera of the
+// TransformationMatrices block, the visible slots are compacted in slot order, so depth order survives, and the
+// renderer's indirect commands, one per run of slots, are rewritten to cover only the visible part of their run. The
+// CPU writes the same commands however many sprites end up visible.
+class GpuSpriteCuller {
+public:
+    // Shader storage binding of the instances, shared with the vertex shader that reads them.
+    static constexpr GLuint instanceBlockBinding = 3;
+
+private:
+    static constexpr GLuint groupSize = 256;
+
+    std::unique_ptr<class ShaderWrapper> markShader;
+    std::unique_ptr<ShaderWrapper> scanShader;
+    std::unique_ptr<ShaderWrapper> compactShader;
+
+    // Visible slots, read as an instanced vertex attribute, and the rewritten commands.
+    GLuint visibleSlotBuffer;
+    GLuint commandBuffer;
+    // Visible slots before each slot within its workgroup, and before each workgroup.
+    GLuint localPrefixBuffer;
+    GLuint groupOffsetBuffer;
+    uint32_t slotCapacity;
+    uint32_t commandCapacity;
+
+    uint32_t groupCount;
+
+    // Visible counts are copied out of groupOffsetBuffer into one slot per Cull() in flight and only read once the
+    // slot's fence has signalled, so the statistics never wait for the GPU. With GL 4.4 the slots stay mapped.
+    static constexpr uint32_t countSlotCount = 3;
+    GLuint countBuffer;
+    const GLuint* mappedCounts;
+    std::array<GLsync, countSlotCount> countFences;
+    uint32_t nextCountSlot;
+    uint32_t latestVisibleCount;
+
+public:
+    GpuSpriteCuller();
+    ~GpuSpriteCuller();
+
+    GpuSpriteCuller(const GpuSpriteCuller&) = delete;
+    GpuSpriteCuller& operator=(const GpuSpriteCuller&) = delete;
+
+    // The instance range holds instanceCount SpriteInstances, the command range commandCount commands whose
+    // baseInstance and instanceCount are slot ranges of it.
+    void Cull(GLuint instanceBuffer, GLintptr instanceOffset, uint32_t instanceCount, GLuint sourceCommandBuffer,
+              GLintptr sourceCommandOffset, uint32_t commandCount);
+
+    // Waits for the last Cull() to finish, only meant for verification.
+    [[nodiscard]] uint32_t ReadVisibleCount() const;
+    // Visible count of the newest Cull() the GPU has finished when the last Cull() was issued, usually a frame or two
+    // old. Never waits.
+    [[nodiscard]] uint32_t GetLatestVisibleCount() const;
+    [[nodiscard]] GLuint GetVisibleSlotBuffer() const;
+    [[nodiscard]] GLuint GetCommandBuffer() const;
+
+private:
+    void Reserve(uint32_t slotCount, uint32_t commandCount);
+    // Takes the counts of every slot whose fence has signalled, oldest first.
+    void CollectVisibleCounts();
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include <vector>
+#include <glad/glad.h>
+
+// Streaming buffer for per-instance data. With GL 4.4 it is one persistently mapped, coherent buffer split into
+// three regions: the CPU writes straight into the next region while the GPU may still read the previous ones,
+// and a fence per region makes sure a region is not overwritten before the draws reading it have finished.
+// Older contexts fall back to a staging copy uploaded with glBufferData.
+struct InstanceRange {
+    GLintptr offset;
+    GLsizeiptr size;
+};
+
+class InstanceRingBuffer {
+private:
+    static constexpr uint32_t regionCount = 3;
+
+    GLuint bufferId;
+    GLsizeiptr regionSize;
+    std::byte* mappedMemory;
+    std::array<GLsync, regionCount> fences;
+    uint32_t currentRegion;
+
+    // Byte ranges changed since each region was last written, and regions that need a full copy.
+    std::array<std::vector<InstanceRange>, regionCount> pendingRanges;
+    std::array<bool, regionCount> isRegionStale;
+
+    bool isPersistent;
+    std::vector<std::byte> stagingMemory;
+
+public:
+    explicit InstanceRingBuffer(GLsizeiptr initialRegionSize);
+    ~InstanceRingBuffer();
+
+    InstanceRingBuffer(const InstanceRingBuffer&) = delete;
+    InstanceRingBuffer& operator=(const InstanceRingBuffer&) = delete;
+
+    // Moves to the next region, growing the buffer when needed, and returns memory for size bytes of instance data.
+    void* BeginWrite(GLsizeiptr size);
+    void EndWrite(GLsizeiptr size);
+
+    // Brings the next region up to date with source, copying only the given ranges plus whatever changed since that
+    // region was last written. Does nothing without dirty ranges. Returns the number of bytes copied.
+    GLsizeiptr WriteRanges(const void* source, GLsizeiptr size, std::span<const InstanceRange> dirtyRanges);
+
+    // Call after the draws that read the current region have been submitted.
+    void FenceCurrentRegion();
+
+    [[nodiscard]] GLuint GetBufferId() const;
+    [[nodiscard]] GLintptr GetCurrentRegionOffset() const;
+    [[nodiscard]] bool IsPersistent() const;
+
+private:
+    void Allocate(GLsizeiptr newRegionSize);
+    void Release();
+    void WaitForRegion(uint32_t region);
+};
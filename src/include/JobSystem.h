@@ -0,0 +1,143 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class JobCounter;
+
+struct Job {
+    using Function = void (*)(void* data, uint32_t begin, uint32_t end);
+
+    Function function = nullptr;
+    void* data = nullptr;
+    uint32_t begin = 0;
+    uint32_t end = 0;
+
+    // Decremented once the job has finished.
+    JobCounter* counter = nullptr;
+    // The job is not started before this counter reaches zero, which is how task graphs are chained.
+    const JobCounter* dependency = nullptr;
+};
+
+class JobCounter {
+private:
+    std::atomic<uint32_t> value;
+    // Jobs dispatched with this counter as their dependency, queued once it reaches zero.
+    mutable std::mutex waitingMutex;
+    mutable std::vector<Job> waitingJobs;
+
+public:
+    JobCounter();
+
+    [[nodiscard]] bool IsDone() const;
+
+    friend class JobSystem;
+};
+
+class JobSystem {
+private:
+    // Ring of jobs from head on. It doubles when full and never shrinks, so dispatching stops allocating once every
+    // queue has held its longest run of jobs.
+    struct alignas(64) WorkerQueue {
+        std::mutex mutex;
+        std::vector<Job> jobs;
+        size_t head = 0;
+        size_t count = 0;
+
+        WorkerQueue();
+
+        void PushBack(const Job& job);
+        bool PopBack(Job& job);
+        bool PopFront(Job& job);
+    };
+
+    static constexpr size_t initialQueueCapacity = 256;
+
+    // Queue 0 belongs to the thread that owns the job system, worker N uses queue N + 1.
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> workers;
+
+    std::atomic<bool> isRunning;
+    std::atomic<uint32_t> pendingJobs;
+
+    std::mutex sleepMutex;
+    std::condition_variable sleepCondition;
+
+    static thread_local uint32_t threadIndex;
+    // The job system threadIndex belongs to. Any other system treats the thread as an outside one and uses queue 0.
+    static thread_local const JobSystem* threadOwner;
+
+public:
+    // onWorkerStart runs on each worker thread before it takes any job, with that worker's thread index.
+    explicit JobSystem(uint32_t workerCount, bool pinThreads = false,
+                       std::function<void(uint32_t)> onWorkerStart = nullptr);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    void Dispatch(const Job& job);
+    void Wait(const JobCounter& counter);
+
+    // Calls function(index) for every index in [0, count), batchSize indices per job. Blocks until done.
+    template<typename Function>
+    void ParallelFor(uint32_t count, uint32_t batchSize, Function&& function);
+
+    // Calls function(begin, end) for consecutive ranges of at most batchSize indices. Blocks until done.
+    template<typename Function>
+    void ParallelForRange(uint32_t count, uint32_t batchSize, Function&& function);
+
+    [[nodiscard]] uint32_t GetWorkerCount() const;
+    [[nodiscard]] static uint32_t GetThreadIndex();
+
+private:
+    void WorkerLoop(uint32_t index, bool pinThread, std::function<void(uint32_t)> onWorkerStart);
+    // The calling thread's queue in this system.
+    [[nodiscard]] uint32_t GetQueueIndex() const;
+    void Enqueue(const Job& job);
+    void FinishJob(const Job& job);
+    bool TryRunJob(uint32_t index);
+    bool PopJob(uint32_t index, Job& job);
+
+    static void PinCurrentThread(uint32_t core);
+};
+
+template<typename Function>
+void JobSystem::ParallelFor(uint32_t count, uint32_t batchSize, Function&& function) {
+    ParallelForRange(count, batchSize, [&function](uint32_t begin, uint32_t end) {
+        for (uint32_t index = begin; index < end; index++)
+            function(index);
+    });
+}
+
+template<typename Function>
+void JobSystem::ParallelForRange(uint32_t count, uint32_t batchSize, Function&& function) {
+    if (count == 0)
+        return;
+
+    batchSize = std::max(batchSize, 1u);
+
+    JobCounter counter;
+    Job job;
+    job.function = [](void* data, uint32_t begin, uint32_t end) {
+        (*static_cast<std::remove_reference_t<Function>*>(data))(begin, end);
+    };
+    job.data = const_cast<void*>(static_cast<const void*>(&function));
+    job.counter = &counter;
+
+    for (uint32_t begin = 0; begin < count; begin += batchSize) {
+        job.begin = begin;
+        job.end = std::min(begin + batchSize, count);
+        Dispatch(job);
+    }
+
+    Wait(counter);
+}
@@ -3,7 +3,8 @@
 #ifdef DEBUG
 #define SPDLOG_ACTIVE_LEVEL SPDLOG_LEVEL_DEBUG
 #else
-#define SPDLOG_ACTIVE_LEVEL SPDLOG_LEVEL_ERROR
+// Info stays in release builds, the measurement modes and the atlas cook report through it.
+#define SPDLOG_ACTIVE_LEVEL SPDLOG_LEVEL_INFO
 #endif
 
 #include "spdlog/spdlog.h"
@@ -1,12 +1,15 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 
 #include <cstdint>
 #include <GLFW/glfw3.h>
 
 #include "glm/vec3.hpp"
 #include "Nodes/Node.h"
+#include "UpdateScheduler.h"
+#include "SceneEditQueue.h"
 #include "glm/gtc/constants.hpp"
 
 class MainEngine {
@@ -14,20 +17,41 @@ private:
     GLFWwindow* window;
 
     class CameraNode* currentCameraNode;
-    Node sceneRoot;
     std::unique_ptr<class SpriteRenderer> renderer;
+    // Owns the GL context while MainLoop() runs.
+    std::unique_ptr<class RenderThread> renderThread;
+    std::vector<std::unique_ptr<class FrameAllocator>> frameAllocators;
+    std::unique_ptr<class JobSystem> jobSystem;
+    UpdateScheduler updateScheduler;
+    SceneEditQueue sceneEditQueue;
+    Node sceneRoot;
 
 public:
     explicit MainEngine();
     virtual ~MainEngine();
 
-    int32_t Init();
+    // An offscreen engine renders into a hidden GLFW window. It still needs a display to create the GL context.
+    int32_t Init(bool isOffscreen = false);
     void PrepareScene();
     int32_t MainLoop();
+    // Renders frameCount frames with and without the opaque pass and prints the fragments written per frame.
+    int32_t MeasureOverdraw(uint32_t frameCount);
+    // Draws frameCount frames at a few camera scales with CPU and GPU culling and compares the images. Returns 1 if any
+    // pair differs.
+    int32_t VerifyGpuCulling(uint32_t frameCount);
+    // Runs frameCount frames under a heavy GL load on one thread, then with the render thread, and prints the average
+    // frame times.
+    int32_t MeasureRenderThread(uint32_t frameCount);
+    // Moves spriteCount sprites every frame and prints the time spent writing their instances with 1 to 8 cores.
+    int32_t MeasureInstanceBuilding(uint32_t spriteCount, uint32_t frameCount);
 
     GLFWwindow *GetWindow() const;
 
     Node &GetSceneRoot();
+    UpdateScheduler &GetUpdateScheduler();
+    JobSystem &GetJobSystem();
+    SceneEditQueue &GetSceneEditQueue();
+    SpriteRenderer &GetRenderer();
 
     CameraNode* GetCurrentCameraNode();
     void SetCurrentCameraNode(CameraNode* currentCameraNode);
@@ -40,7 +64,10 @@ private:
     int32_t InitializeWindow();
     void InitializeImGui(const char* GLSLVersion);
     void UpdateWidget(float DeltaSeconds);
+    void UpdateScene(float seconds, float deltaSeconds);
+    void UpdateAndDrawScene(float seconds, float deltaSeconds);
     static  void CheckGLErrors();
+    float MeasureJobDispatchOverhead();
 
     std::shared_ptr<class RigidbodyNode> CreateRigidbodyTile(const std::shared_ptr<class Sprite>& sprite);
 
@@ -2,23 +2,31 @@
 
 
 #include "Node.h"
+#include "Bounds2D.h"
 
 class CameraNode : public Node {
 private:
     std::unique_ptr<class Camera> camera;
     class MainEngine* engine;
+    class UpdateScheduler* scheduler;
 
     CameraNode();
-    CameraNode(Node* node);
 public:
     CameraNode(MainEngine* engine);
     virtual ~CameraNode();
 
-    void Update(struct MainEngine* engine, float seconds, float deltaSeconds) override;
+    void UpdateCamera(struct MainEngine* engine, float seconds, float deltaSeconds);
     void MakeCurrent();
 
     [[nodiscard]] std::shared_ptr<Node> Clone() const override;
 
     [[nodiscard]] float GetScale() const;
     void SetScale(float scale);
+    [[nodiscard]] Bounds2D GetVisibleBounds() const;
+    [[nodiscard]] glm::mat4 GetProjectionMatrix() const;
+    [[nodiscard]] glm::mat4 GetViewMatrix() const;
+
+protected:
+    void OnStart(struct MainEngine* engine) override;
+    void OnStop(struct MainEngine* engine) override;
 };
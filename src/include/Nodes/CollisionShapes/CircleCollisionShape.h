@@ -15,6 +15,8 @@ public:
 
     static bool IsCirclesColliding(class RigidbodyNode* selfNode, RigidbodyNode* anotherNode);
     static glm::vec2 GetSeparationVectorBetweenCircles(RigidbodyNode* selfNode, RigidbodyNode* anotherNode);
+    static glm::vec2 GetSeparationVectorBetweenCircles(float selfRadius, glm::vec2 selfPosition,
+                                                       float anotherRadius, glm::vec2 anotherPosition);
 
     static bool IsCircleCollidingWithRectangle(RigidbodyNode* selfNode, RigidbodyNode* anotherNode);
     static glm::vec2 GetSeparationVectorBetweenCircleAndRectangle(RigidbodyNode* selfNode, RigidbodyNode* anotherNode);
@@ -15,6 +15,11 @@ public:
     static bool IsRectanglesColliding(class RigidbodyNode* selfNode, RigidbodyNode* anotherNode);
     static glm::vec2 GetSeparationVectorBetweenRectangles(RigidbodyNode* selfNode, RigidbodyNode* anotherNode);
 
+    static bool IsRectanglesColliding(const RectangleCollisionShape* selfShape, glm::vec3 selfPosition,
+                                      const RectangleCollisionShape* anotherShape, glm::vec3 anotherPosition);
+    static glm::vec2 GetSeparationVectorBetweenRectangles(const RectangleCollisionShape* selfShape, glm::vec3 selfPosition,
+                                                          const RectangleCollisionShape* anotherShape, glm::vec3 anotherPosition);
+
     std::shared_ptr<CollisionShape> Clone() override;
 
     [[nodiscard]] float GetLeft(glm::vec3 position) const;
@@ -3,13 +3,28 @@
 
 #include "Node.h"
 #include <map>
+#include <memory>
+
+#include "TileLayer.h"
 
 class Map : public Node {
 private:
     glm::vec2 size;
 
+    // Set when the map's sprites are drawn as a single TileLayer instead of one SpriteNode per tile.
+    std::unique_ptr<TileLayer> tileLayer;
+    class SpriteRenderer* tileLayerRenderer;
+
 public:
     Map(const std::string &path, const std::map<char, class Node *> &Nodes);
+    // Tiles whose sprite is a plain SpriteNode go into a TileLayer drawn by the given renderer. Prototypes with other
+    // behaviour (collisions) are still cloned, without their sprite.
+    Map(const std::string &path, const std::map<char, class Node *> &Nodes, SpriteRenderer* tileLayerRenderer,
+        TileLayerMode tileLayerMode = TileLayerMode::IndexTexture);
+    virtual ~Map();
 
     const glm::vec2 &GetSize() const;
+
+protected:
+    void ApplyRenderLayer(uint8_t layer) override;
 };
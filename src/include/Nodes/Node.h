@@ -10,47 +10,93 @@ class Node
 {
 private:
     std::shared_ptr<Transform> localTransform;
+    // Transform and version worldTransformMatrix was last computed from, null until the first computation.
+    const Transform* appliedTransform;
+    uint32_t appliedTransformVersion;
     glm::mat4 worldTransformMatrix;
 
     Node* parent;
     std::vector<std::shared_ptr<Node>> childrenList;
+    uint32_t indexInParent;
+    // Render layer the node is drawn in, see SpriteRenderer::AddRenderLayer. Nodes without a layer of their own
+    // (ownRenderLayer 0) inherit their parent's, and pick up the new parent's when they are moved.
+    uint8_t renderLayer;
+    uint8_t ownRenderLayer;
 
     bool wasDirty;
+    bool isStarted;
 public:
     explicit Node();
 
+    // Copies would share the children without being their parent, go through Clone() instead.
+    Node(const Node&) = delete;
+    Node& operator=(const Node&) = delete;
+
     void CalculateWorldTransform();
     void Draw();
-    virtual void Update(class MainEngine* engine, float seconds, float deltaSeconds);
-    virtual void Start(class MainEngine* engine);
+    // Starts the node and its subtree. Nodes that are already started are skipped, so a subtree can be started again
+    // after new children were added.
+    void Start(class MainEngine* engine);
+    // Releases the scheduler and renderer registrations of the subtree, a stopped node is neither updated nor drawn
+    // until it is started again.
+    void Stop(class MainEngine* engine);
+    [[nodiscard]] bool IsStarted() const;
 
     void AddChild(std::shared_ptr<Node> newChild);
+    // Swap-removes the child in O(1), so the order of the remaining children is not preserved.
+    std::shared_ptr<Node> RemoveChild(Node* child);
 
     const std::vector<std::shared_ptr<Node>>& GetChildrenList() const;
 
-    Transform* GetLocalTransform();
+    const Transform* GetLocalTransform() const;
+    // Gives the node a private copy of a transform it still shares with its prototype, use it only to write.
+    Transform* MutableLocalTransform();
     glm::vec3 GetWorldPosition() const;
     const glm::mat4* GetWorldTransformMatrix() const;
 
     [[nodiscard]] bool WasDirtyThisFrame() const;
 
+    // Gives the node and every descendant without a layer of its own the render layer, 0 makes the node inherit its
+    // parent's layer again.
+    void SetRenderLayer(uint8_t layer);
+    [[nodiscard]] uint8_t GetRenderLayer() const;
+
+    // Clones share the prototype's transform (and subclasses their immutable data)
+    // until the first write through MutableLocalTransform(), so prefab copies stay cheap.
     virtual std::shared_ptr<Node> Clone() const;
 
-    template<typename Predicate>
-    void GetAllNodes(std::vector<Node*>& foundArray, Predicate predicate);
+    template<typename Container, typename Predicate>
+    void GetAllNodes(Container& foundArray, Predicate predicate);
 
     template<typename Predicate>
     Node* GetChild(Predicate predicate);
 
     Node* GetParent() const;
 
+private:
+    // RemoveChild() without resetting the inherited render layer, for AddChild() to move a node.
+    std::shared_ptr<Node> DetachChild(Node* child);
+
 protected:
+    [[nodiscard]] bool IsLocalTransformDirty() const;
+    // Shares the transform with clone and adds clones of the children to it. Clone() overrides construct the derived
+    // node first and call this, so every cloned child has the clone itself as its parent.
+    void CloneInto(Node& clone) const;
+
     virtual void Draw(glm::mat4& parentTransform, bool isDirty);
     void CalculateWorldTransform(glm::mat4& parentTransform, bool isDirty);
+    // Registers the node's update methods, called once per Start() of a stopped node.
+    virtual void OnStart(class MainEngine* engine);
+    // Undoes OnStart().
+    virtual void OnStop(class MainEngine* engine);
+    // Called after worldTransformMatrix was recomputed.
+    virtual void OnWorldTransformChanged();
+    // Sets the inherited render layer of the node and passes it on to the children without a layer of their own.
+    virtual void ApplyRenderLayer(uint8_t layer);
 };
 
-template<typename Predicate>
-void Node::GetAllNodes(std::vector<Node*> &foundArray, Predicate predicate) {
+template<typename Container, typename Predicate>
+void Node::GetAllNodes(Container &foundArray, Predicate predicate) {
     if (predicate(this))
         foundArray.push_back(this);
 
@@ -7,13 +7,18 @@ class ParallaxNode : public Node {
 private:
     float lagFactor;
     glm::vec3 lastCameraLocation;
+    class UpdateScheduler* scheduler;
+    // The subtree is drawn in its own render layer and scrolling only moves the layer offset, so the children's
+    // transforms stay clean. Without a free layer the node falls back to moving its own transform.
+    class SpriteRenderer* renderer;
+    uint8_t scrollLayer;
+    glm::vec2 scrollOffset;
 
 public:
     ParallaxNode(float lagFactor);
+    virtual ~ParallaxNode();
 
-    void Start(struct MainEngine* engine) override;
-
-    void Update(struct MainEngine* engine, float seconds, float deltaSeconds) override;
+    void UpdateParallax(struct MainEngine* engine, float seconds, float deltaSeconds);
 
 
     [[nodiscard]] float GetLagFactor() const;
@@ -21,6 +26,8 @@ public:
     void SetLagFactor(float lagFactor);
 
 protected:
+    void OnStart(struct MainEngine* engine) override;
+    void OnStop(struct MainEngine* engine) override;
     void Draw(glm::mat4& parentTransform, bool isDirty) override;
 
 };
@@ -10,11 +10,15 @@ private:
     float fallGravityFactor;
     float buttonPressJumpGravityFactor;
 
+    glm::vec2 input;
+
     std::shared_ptr<Node> playerSprite;
 public:
     PlayerNode(class MainEngine* engine, class SpriteRenderer* renderer);
+    virtual ~PlayerNode();
 
-    void Update(struct MainEngine *engine, float seconds, float deltaSeconds) override;
+    void HandleInput(struct MainEngine* engine, float seconds, float deltaSeconds);
+    void UpdateMovement(struct MainEngine* engine, float seconds, float deltaSeconds);
 
     void SetJumpParameters(float targetHeight, float targetDistance);
     void SetPlayerSpeed(float playerSpeed);
@@ -25,6 +29,10 @@ public:
     float GetStartJumpVelocity() const;
     float GetFallGravityFactor() const;
 
+protected:
+    void OnStart(struct MainEngine* engine) override;
+    void OnStop(struct MainEngine* engine) override;
+
 private:
     glm::vec2 GetMovementInput(MainEngine* Engine);
     std::shared_ptr<class SpriteArrayNode> CreatePlayerSprite(MainEngine* engine, SpriteRenderer* renderer);
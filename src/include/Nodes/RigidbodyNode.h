@@ -7,6 +7,7 @@
 
 class RigidbodyNode : public Node {
 private:
+    // Shared between clones, replace it with SetCollisionShape instead of mutating it.
     std::shared_ptr<class CollisionShape> collisionShape;
 
     glm::vec2 acceleration;
@@ -17,17 +18,19 @@ private:
     bool isKinematic;
     bool isTrigger;
 
-    explicit RigidbodyNode(const Node& obj);
-
     std::vector<RigidbodyNode*> overlappedNodesThisFrame;
 
+protected:
+    class UpdateScheduler* scheduler;
+
 public:
     eventpp::CallbackList<void(RigidbodyNode*)> onCollisionEnter;
 
     explicit RigidbodyNode(std::shared_ptr<class CollisionShapeFactory> collisionShapeFactory);
     explicit RigidbodyNode(std::shared_ptr<class CollisionShape> collisionShape);
+    virtual ~RigidbodyNode();
 
-    void Update(struct MainEngine* engine, float seconds, float deltaSeconds) override;
+    void UpdatePhysics(struct MainEngine* engine, float seconds, float deltaSeconds);
 
     [[nodiscard]] std::shared_ptr<Node> Clone() const override;
     [[nodiscard]] const glm::vec2& GetVelocity() const;
@@ -35,7 +38,7 @@ public:
     [[nodiscard]] bool IsKinematic() const;
     [[nodiscard]] bool IsTrigger() const;
     [[nodiscard]] const std::shared_ptr<struct CollisionShape>& GetCollisionShape() const;
-    std::vector<RigidbodyNode*> GetOverlappedNodesThisFrame();
+    [[nodiscard]] const std::vector<RigidbodyNode*>& GetOverlappedNodesThisFrame() const;
 
     void SetVelocity(const glm::vec2& velocity);
     void SetAcceleration(const glm::vec2& acceleration);
@@ -44,6 +47,9 @@ public:
     void SetCollisionShape(const std::shared_ptr<struct CollisionShape>& collisionShape);
 
 protected:
+    void OnStart(struct MainEngine* engine) override;
+    void OnStop(struct MainEngine* engine) override;
+
     glm::vec2 CalculateSeparationVector(RigidbodyNode* selfRigidbody, RigidbodyNode* anotherRigidbody);
 
     void HandleCollisions(MainEngine* engine);
@@ -11,12 +11,20 @@ private:
     float timeFromLastFrame;
     float timeBetweenFrames;
     bool isLooping;
+
+    class UpdateScheduler* scheduler;
 public:
     SpriteArrayNode(const std::vector<std::shared_ptr<Sprite>>& spriteArray, class SpriteRenderer* renderer);
+    virtual ~SpriteArrayNode();
+
     void PlayAnimation(const std::vector<int>& animation, float timeBetweenFrames, bool loop = true);
 
+protected:
+    void OnStart(struct MainEngine* engine) override;
+    void OnStop(struct MainEngine* engine) override;
+
 private:
-    void Update(struct MainEngine* engine, float seconds, float deltaSeconds) override;
+    void UpdateAnimation(struct MainEngine* engine, float seconds, float deltaSeconds);
 
 private:
     [[nodiscard]] std::shared_ptr<Node> Clone() const override;
@@ -3,13 +3,35 @@
 #include <memory>
 
 #include "Node.h"
+#include "Bounds2D.h"
 
 class SpriteNode: public Node {
 private:
 
     class SpriteRenderer* renderer;
+    uint32_t rendererIndex;
+    // Cleared while the node is stopped, a stopped sprite has no slot in the renderer.
+    bool isInRenderer;
 
-    explicit SpriteNode(const Node &obj);
+    Bounds2D gridBounds;
+    uint64_t gridCell;
+    uint32_t gridIndex;
+
+    // Palette row for indexed materials, 0 draws with the material's own palette.
+    uint8_t palette;
+
+    // Frames in a row without a transform or sprite change, a node that stays clean long enough becomes static.
+    uint16_t cleanFrames;
+    // Transform cannot be packed into a SpriteInstance, only kept up to date while the renderer uses matrix instances.
+    bool needsMatrixInstance;
+    bool isStaticHint;
+    bool hasSpriteChangedWhileStatic;
+    class StaticSpriteBatch* staticBatch;
+    uint64_t staticChunk;
+    uint32_t staticIndex;
+
+    // An empty node for Clone(), which fills it in and adds it to the renderer.
+    SpriteNode();
 
 protected:
     std::shared_ptr<class Sprite> sprite;
@@ -20,9 +42,25 @@ public:
     std::shared_ptr<Node> Clone() const override;
 
     [[nodiscard]] const Sprite* getSprite() const;
+    // Swapping the sprite tells the renderer which instance slot needs new tile coordinates.
+    void SetSprite(const std::shared_ptr<Sprite>& newSprite);
+    // Swaps the colours of an indexed sprite, see SpriteRenderer::AddPalette(). Costs one instance upload. Palettes past
+    // spriteInstancePaletteCount do not fit the instance flags and are rejected.
+    void SetPalette(uint8_t newPalette);
+    [[nodiscard]] uint8_t GetPalette() const;
+    // Marks a sprite that is not expected to move, so the renderer bakes it without waiting for it to stay clean.
+    void SetIsStatic(bool isStatic);
     virtual ~SpriteNode();
 
 protected:
     void Draw(glm::mat4 &ParentTransform, bool IsDirty) override;
+    void OnStart(struct MainEngine* engine) override;
+    void OnStop(struct MainEngine* engine) override;
+    // Moving a baked sprite queues it for demotion, see SpriteRenderer::MarkSpriteDirty().
+    void OnWorldTransformChanged() override;
+    void ApplyRenderLayer(uint8_t layer) override;
 
+    friend class SpriteRenderer;
+    friend class SpriteGrid;
+    friend class StaticSpriteBatch;
 };
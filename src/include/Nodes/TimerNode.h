@@ -9,14 +9,15 @@ class TimerNode : public Node {
     float timeLeft;
     float waitTime;
 
-    TimerNode(Node* obj);
+    class UpdateScheduler* scheduler;
 
 public:
     eventpp::CallbackList<void()> onTimeout;
 
     TimerNode(float waitTime);
+    virtual ~TimerNode();
 
-    void Update(struct MainEngine* engine, float seconds, float deltaSeconds) override;
+    void UpdateTimer(struct MainEngine* engine, float seconds, float deltaSeconds);
     std::shared_ptr<Node> Clone() const override;
 
     void StartTimer();
@@ -29,4 +30,8 @@ public:
     bool IsPaused() const;
     float GetTimeLeft() const;
     float GetWaitTime() const;
+
+protected:
+    void OnStart(struct MainEngine* engine) override;
+    void OnStop(struct MainEngine* engine) override;
 };
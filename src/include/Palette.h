@@ -0,0 +1,27 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Up to 256 RGBA colours for palette indexed art. Index 0 is always fully transparent, the loaded colours follow it.
+class Palette {
+public:
+    using Color = std::array<uint8_t, 4>;
+    static constexpr size_t maxColors = 256;
+
+private:
+    std::vector<Color> colors;
+
+public:
+    Palette();
+
+    // Reads one "#rrggbb" or "#rrggbbaa" colour per line, the format of ColorPallete.txt.
+    bool LoadFromFile(const std::string& path);
+    bool AddColor(Color color);
+
+    // Texels below half alpha map to index 0, the others to the closest colour by RGB distance.
+    [[nodiscard]] uint8_t FindClosest(const uint8_t* rgba) const;
+    [[nodiscard]] const std::vector<Color>& GetColors() const;
+};
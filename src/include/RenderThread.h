@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <glm/glm.hpp>
+#include <imgui.h>
+
+#include "SpriteFrame.h"
+
+struct GLFWwindow;
+
+// Everything one frame is drawn from, copied out of the scene and ImGui so both can move on to the next frame.
+struct RenderSnapshot {
+    glm::ivec2 framebufferSize = glm::ivec2(0);
+    SpriteFrame sprites;
+    // Points into uiDrawLists, clones of the lists ImGui::Render() produced.
+    ImDrawData uiDrawData;
+    std::vector<ImDrawList*> uiDrawLists;
+
+    RenderSnapshot() = default;
+    ~RenderSnapshot();
+
+    RenderSnapshot(const RenderSnapshot&) = delete;
+    RenderSnapshot& operator=(const RenderSnapshot&) = delete;
+
+    void SetUiDrawData(const ImDrawData& drawData);
+};
+
+struct RenderThreadStatistics {
+    // How long BeginFrame() waited for a free snapshot, and how long the render thread took for the last one.
+    float waitMilliseconds = 0.f;
+    float drawMilliseconds = 0.f;
+};
+
+// Owns the GL context and draws snapshots handed over by the simulation. There are two of them, so the simulation
+// prepares frame N + 1 while frame N is submitted. Snapshots are never skipped, their sprite frames only hold the
+// instance bytes that changed since the frame before.
+class RenderThread {
+private:
+    GLFWwindow* window;
+    class SpriteRenderer& renderer;
+    uint32_t submitCount;
+
+    std::array<RenderSnapshot, 2> snapshots;
+    uint32_t writeIndex;
+    // Snapshot waiting for the render thread and the one it draws, -1 for none.
+    int32_t pendingIndex;
+    int32_t drawingIndex;
+    bool isStopping;
+    RenderThreadStatistics statistics;
+
+    mutable std::mutex mutex;
+    std::condition_variable condition;
+    std::thread thread;
+
+public:
+    // The context must not be current on the calling thread. submitCount > 1 submits every sprite frame that many
+    // times, a deliberately heavy GL load for measurements.
+    RenderThread(GLFWwindow* window, SpriteRenderer& renderer, uint32_t submitCount = 1);
+    // Draws what was handed over and releases the context, make it current again on the calling thread afterwards.
+    ~RenderThread();
+
+    RenderThread(const RenderThread&) = delete;
+    RenderThread& operator=(const RenderThread&) = delete;
+
+    // Waits until the render thread holds at most the other snapshot and returns the one to fill.
+    RenderSnapshot& BeginFrame();
+    // Hands the snapshot of BeginFrame() to the render thread.
+    void EndFrame();
+
+    [[nodiscard]] RenderThreadStatistics GetStatistics() const;
+
+    // Clears, submits, draws the UI and swaps. Needs the window's context on the calling thread.
+    static void DrawSnapshot(GLFWwindow* window, SpriteRenderer& renderer, RenderSnapshot& snapshot,
+                             uint32_t submitCount = 1);
+
+private:
+    void Run();
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+class Node;
+
+// Collects structural scene edits made while the frame is running and applies them together at a sync point,
+// so nothing iterating the tree or the update lists sees nodes appear or disappear underneath it.
+class SceneEditQueue {
+private:
+    enum class EditType {
+        AddChild,
+        Remove,
+        Reparent
+    };
+
+    struct Edit {
+        EditType type;
+        Node* parent;
+        Node* node;
+        std::shared_ptr<Node> newNode;
+    };
+
+    std::vector<Edit> edits;
+    std::vector<std::shared_ptr<Node>> removedNodes;
+    std::vector<std::shared_ptr<Node>> addedNodes;
+
+public:
+    void QueueAddChild(Node* parent, std::shared_ptr<Node> child);
+    void QueueRemove(Node* node);
+    // Rejected when the node has no parent or newParent is inside the node's own subtree.
+    void QueueReparent(Node* node, Node* newParent);
+
+    void Apply(class MainEngine* engine);
+
+    [[nodiscard]] bool IsEmpty() const;
+
+private:
+    static bool IsInSubtree(const Node* node, const Node* subtreeRoot);
+};
@@ -1,39 +1,113 @@
 #pragma once
 
 #include <glad/glad.h>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <vector>
 #include <glm/glm.hpp>
 
+// FNV-1a, the same at compile time and when the linked program is reflected.
+constexpr uint64_t HashUniformName(std::string_view Name)
+{
+    uint64_t Hash = 14695981039346656037ull;
+    for (char Character : Name)
+    {
+        Hash = (Hash ^ static_cast<unsigned char>(Character)) * 1099511628211ull;
+    }
+    return Hash;
+}
+
+// Uniform name hashed at compile time. Arrays are named without their [0].
+struct UniformName
+{
+    const char* Name;
+    uint64_t Hash;
+
+    consteval UniformName(const char* Name) : Name(Name), Hash(HashUniformName(Name))
+    {
+    }
+};
+
+// A uniform block the shaders declare with an explicit binding. Block is the C++ struct with the same std140 layout.
+template<typename Block>
+struct UniformBlock
+{
+    UniformName Name;
+    GLuint Binding;
+
+    static constexpr GLsizeiptr Size = sizeof(Block);
+};
 
 class ShaderWrapper
 {
 private:
+    struct UniformSlot
+    {
+        uint64_t Hash = 0;
+        // -1 marks an empty slot.
+        GLint Location = -1;
+    };
+
+    struct ReflectedBlock
+    {
+        uint64_t Hash;
+        GLint Binding;
+        GLint DataSize;
+    };
+
     GLuint ShaderProgramID = -1;
+    class GlStateCache* StateCache = nullptr;
+    // Active uniforms outside blocks, open addressed by name hash. The size is a power of two at least twice the
+    // uniform count, so a lookup rarely probes more than one slot.
+    std::vector<UniformSlot> UniformTable;
+    uint64_t UniformTableMask = 0;
+    std::vector<ReflectedBlock> UniformBlocks;
 
 public:
     ShaderWrapper(std::string VertexShaderPath, std::string FragmentShaderPath);
     ShaderWrapper(std::string VertexShaderPath, std::string FragmentShaderPath, std::string GeometryShaderPath);
+    // Compute program, run with glDispatchCompute after Activate().
+    explicit ShaderWrapper(std::string ComputeShaderPath);
+
+    // Program switches and uniform writes then go through the cache and are skipped when nothing changes.
+    void SetStateCache(GlStateCache* NewStateCache);
 
     void Activate() const;
 
-    void SetBool(const std::string& Name, bool Value) const;
-    void SetInt(const std::string& Name, int Value) const;
-    void SetFloat(const std::string& Name, float Value) const;
-    void SetVec4F(const std::string& Name, glm::vec4 Value) const;
-    void SetMat4F(const std::string& Name, glm::mat4 Value) const;
+    void SetBool(UniformName Name, bool Value) const;
+    void SetInt(UniformName Name, int Value) const;
+    void SetUInt(UniformName Name, GLuint Value) const;
+    void SetFloat(UniformName Name, float Value) const;
+    void SetVec4F(UniformName Name, glm::vec4 Value) const;
+    void SetIVec2(UniformName Name, glm::ivec2 Value) const;
+    void SetMat4F(UniformName Name, glm::mat4 Value) const;
 
     GLint TrySetVec4f(const std::string& Name, glm::vec4 Value) const;
 
+    // Logs an error and returns false if the program lacks the block or declares it with another binding or size.
+    template<typename Block>
+    bool HasUniformBlock(const UniformBlock<Block>& Descriptor) const
+    {
+        return HasUniformBlock(Descriptor.Name, Descriptor.Binding, Descriptor.Size);
+    }
+
     GLuint GetShaderProgramId() const;
 
 private:
-    [[nodiscard]] GLint GetUniformLocation(const std::string& Name) const;
+    [[nodiscard]] GLint GetUniformLocation(UniformName Name) const;
+    [[nodiscard]] bool HasUniformBlock(UniformName Name, GLuint Binding, GLsizeiptr Size) const;
+    void ReflectProgram();
+    [[nodiscard]] bool IsUniformUnchanged(GLint UniformLocation, const void* Value, size_t Size) const;
     static void LoadShader(std::string& ShaderPath, std::string& ShaderCodeOut);
 
     static GLuint CompileVertexShader(std::string& VertexShaderPath);
     static GLuint CompileFragmentShader(std::string& FragmentShaderPath);
     static GLuint CompileGeometryShader(std::string& GeometryShaderPath);
+    static GLuint CompileComputeShader(std::string& ComputeShaderPath);
     void LinkProgram(GLuint VertexShader, GLuint FragmentShader, GLuint GeometryShader);
+    void LinkProgram(GLuint ComputeShader);
+    void LogLinkError();
 
     static void CompileShader(std::string& ShaderPath, GLuint Shader);
     static void LogShaderError(GLuint GeometryShader, const std::string& Message);
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <optional>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Bottom-left skyline packing. The packed area is described by the height of its top edge, one segment per step, and
+// a rectangle goes wherever its top ends lowest. Placement is deterministic, so inserting the same sizes in the same
+// order gives the same positions again.
+class SkylinePacker {
+private:
+    struct Segment {
+        int x;
+        int y;
+        int width;
+    };
+
+    glm::ivec2 size;
+    std::vector<Segment> skyline;
+
+public:
+    explicit SkylinePacker(glm::ivec2 size);
+
+    // Returns the bottom left corner of the placed rectangle, or nothing if it does not fit anywhere.
+    std::optional<glm::ivec2> Insert(glm::ivec2 rectSize);
+    void Clear();
+
+    [[nodiscard]] glm::ivec2 GetSize() const;
+
+private:
+    // Height the rectangle rests at with its left edge on the segment, or -1 if it would stick out.
+    [[nodiscard]] int GetRestingHeight(size_t segment, glm::ivec2 rectSize) const;
+};
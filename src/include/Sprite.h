@@ -5,10 +5,13 @@
 class Sprite {
 private:
     glm::vec<2, int> TileMapPosition;
+    // Index returned by SpriteRenderer::AddMaterial(), 0 is the renderer's own atlas.
+    uint16_t Material;
 public:
-    explicit Sprite(const glm::vec<2, int> &tileMapPosition);
+    explicit Sprite(const glm::vec<2, int> &tileMapPosition, uint16_t material = 0);
 
     [[nodiscard]] const glm::vec<2, int> &GetTileMapPosition() const;
+    [[nodiscard]] uint16_t GetMaterial() const;
 
     friend class SpriteArrayNode;
 };
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Bounds2D.h"
+#include "DrawElementsIndirectCommand.h"
+#include "InstanceRingBuffer.h"
+#include "SpriteInstance.h"
+
+// Must match the layerOffsets array size in the shaders.
+constexpr uint8_t maxRenderLayers = 16;
+
+// A static batch baked again, the render thread replaces its buffers with these.
+struct StaticBatchUpload {
+    uint64_t key;
+    uint16_t material;
+    uint8_t renderLayer;
+    std::vector<SpriteInstance> instances;
+    std::vector<DrawElementsIndirectCommand> commands;
+    // Bounds of every chunk, in command order.
+    std::vector<Bounds2D> commandBounds;
+};
+
+// Defined in TileLayer.h.
+enum class TileLayerMode;
+
+struct TileCellChange {
+    glm::ivec2 cell;
+    uint16_t value;
+};
+
+// Cells of a tile layer for the render thread, which keeps the layer's texture or mesh in a BakedTileLayer.
+struct TileLayerUpload {
+    uint32_t id;
+    TileLayerMode mode;
+    glm::ivec2 size;
+    // Every cell on the first upload of a layer, empty afterwards.
+    std::vector<uint16_t> cells;
+    // Cells written since the previous upload.
+    std::vector<TileCellChange> changedCells;
+};
+
+// A tile layer or a static batch, drawn in between the sprites at its depth.
+struct SpriteFramePass {
+    float depth;
+    // Names the BakedTileLayer to draw, 0 for static batches. The transform and render layer are copied.
+    uint32_t tileLayerId;
+    glm::mat4 tileLayerTransform;
+    uint8_t renderLayer;
+    uint64_t staticBatchKey;
+};
+
+// Everything SpriteRenderer::Submit() needs from one Prepare(). Holds copies instead of pointers into the scene, so the
+// scene can be updated for the next frame while this one is drawn. Reused from frame to frame, the vectors keep their
+// capacity.
+struct SpriteFrame {
+    glm::mat4 projection = glm::mat4(1.f);
+    glm::mat4 view = glm::mat4(1.f);
+    Bounds2D viewBounds = {};
+    std::array<glm::vec4, maxRenderLayers> renderLayerOffsets = {};
+    bool areRenderLayerOffsetsDirty = false;
+
+    // Instance bytes that changed since the previous frame, back to back in the order of their ranges. Frames must
+    // be submitted in the order they were prepared.
+    bool useCompactInstances = true;
+    uint32_t instanceCount = 0;
+    std::vector<InstanceRange> instanceRanges;
+    std::vector<std::byte> instanceBytes;
+    // Tile index and render layer of matrix instances.
+    std::vector<InstanceRange> tileRanges;
+    std::vector<std::byte> tileBytes;
+
+    std::vector<DrawElementsIndirectCommand> drawCommands;
+    std::vector<uint16_t> drawCommandMaterials;
+    uint32_t opaqueCommandCount = 0;
+    uint32_t opaqueEnd = 0;
+
+    // Sorted by depth. passes[i] is drawn before the translucent slots from splits[i] on.
+    std::vector<SpriteFramePass> passes;
+    std::vector<uint32_t> splits;
+    std::vector<StaticBatchUpload> staticBatchUploads;
+    std::vector<uint64_t> removedStaticBatches;
+    std::vector<TileLayerUpload> tileLayerUploads;
+    std::vector<uint32_t> removedTileLayers;
+
+    bool isCulling = false;
+    bool isGpuCulling = false;
+    bool isOpaquePassEnabled = true;
+    bool hasTranslucentTiles = false;
+    bool isCountingFragments = false;
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "Bounds2D.h"
+#include "Nodes/SpriteNode.h"
+
+// Sparse uniform grid of sprite nodes, keyed by the cell that holds a node's center. Nodes larger than a cell are
+// kept in a separate list and tested one by one, so a query only has to widen its cell range by half a cell.
+class SpriteGrid {
+public:
+    static constexpr uint64_t noCell = UINT64_MAX;
+
+private:
+    static constexpr uint64_t largeCell = UINT64_MAX - 1;
+
+    float cellSize;
+    std::unordered_map<uint64_t, std::vector<SpriteNode*>> cells;
+    std::vector<SpriteNode*> largeNodes;
+
+public:
+    explicit SpriteGrid(float cellSize);
+
+    // Inserts the node or moves it to the cell matching its new bounds.
+    void Update(SpriteNode* node, const Bounds2D& bounds);
+    void Remove(SpriteNode* node);
+
+    // Calls callback(SpriteNode*) for every node whose bounds overlap the given bounds.
+    template<typename Callback>
+    void Query(const Bounds2D& bounds, Callback&& callback) const;
+
+private:
+    [[nodiscard]] int32_t GetCellCoordinate(float position) const;
+    static uint64_t GetCellKey(int32_t x, int32_t y);
+
+    std::vector<SpriteNode*>& GetCellNodes(uint64_t cell);
+};
+
+template<typename Callback>
+void SpriteGrid::Query(const Bounds2D& bounds, Callback&& callback) const {
+    for (SpriteNode* node : largeNodes) {
+        if (node->gridBounds.Overlaps(bounds))
+            callback(node);
+    }
+
+    float margin = cellSize * 0.5f;
+    int32_t minX = GetCellCoordinate(bounds.min.x - margin);
+    int32_t minY = GetCellCoordinate(bounds.min.y - margin);
+    int32_t maxX = GetCellCoordinate(bounds.max.x + margin);
+    int32_t maxY = GetCellCoordinate(bounds.max.y + margin);
+
+    auto visitCell = [&bounds, &callback](const std::vector<SpriteNode*>& cellNodes) {
+        for (SpriteNode* node : cellNodes) {
+            if (node->gridBounds.Overlaps(bounds))
+                callback(node);
+        }
+    };
+
+    // When zoomed far out walking the occupied cells is cheaper than probing every cell in range.
+    uint64_t cellsInRange = uint64_t(maxX - minX + 1) * uint64_t(maxY - minY + 1);
+    if (cellsInRange > cells.size()) {
+        for (const auto& [key, cellNodes] : cells)
+            visitCell(cellNodes);
+        return;
+    }
+
+    for (int32_t y = minY; y <= maxY; y++) {
+        for (int32_t x = minX; x <= maxX; x++) {
+            auto cell = cells.find(GetCellKey(x, y));
+            if (cell != cells.end())
+                visitCell(cell->second);
+        }
+    }
+}
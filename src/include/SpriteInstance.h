@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+
+enum SpriteInstanceFlags : uint8_t {
+    SpriteInstanceFlipX = 1 << 0,
+    SpriteInstanceFlipY = 1 << 1,
+    SpriteInstanceRotate90 = 1 << 2,
+};
+
+// The bits of flags above the transform flags hold the palette of indexed materials, 0 uses the material's own.
+constexpr uint8_t spriteInstancePaletteShift = 3;
+constexpr uint8_t spriteInstancePaletteCount = 1 << (8 - spriteInstancePaletteShift);
+
+// Per-instance data of the compact sprite path, 20 bytes instead of a mat4 plus tile coordinates. Covers translation,
+// per-axis scale, flips and quarter turns; anything else needs the matrix path.
+struct SpriteInstance {
+    glm::vec3 position;
+    // Half floats, always positive, the sign lives in the flip flags.
+    uint16_t scale[2];
+    uint16_t tileIndex;
+    uint8_t flags;
+    // Render layer whose offset the vertex shader adds to position.
+    uint8_t layer;
+};
+
+static_assert(sizeof(SpriteInstance) == 20);
+
+// Returns false if the transform cannot be expressed as a SpriteInstance. Leaves tileIndex, the palette bits and layer
+// untouched.
+bool PackSpriteTransform(const glm::mat4& transform, SpriteInstance& instance);
+
+// Replaces the palette bits of flags.
+void SetSpriteInstancePalette(SpriteInstance& instance, uint8_t palette);
@@ -1,40 +1,375 @@
 #pragma once
 
+#include <array>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <glad/glad.h>
+#include <glm/glm.hpp>
 #include <vector>
 
+#include "SpriteInstance.h"
+#include "SpriteGrid.h"
+#include "FrameAllocator.h"
+#include "DrawElementsIndirectCommand.h"
+#include "SpriteFrame.h"
+#include "ShaderWrapper.h"
+
 bool NodeDepthComparator(class Node*, class Node*);
 
+// How a tile of the atlas has to be drawn, found from its alpha channel when the atlas is loaded.
+enum class TileOpacity : uint8_t {
+    Opaque,
+    // Only fully transparent and fully opaque texels, correct in any order with a discard.
+    AlphaTested,
+    Translucent
+};
+
+// One atlas and what is derived from it. Sprites are batched by material, each one costs a texture bind and a
+// multi-draw per pass instead of a renderer of its own.
+struct SpriteMaterial {
+    GLuint texture = 0;
+    // R8UI palette indices instead of colours, resolved through the palette texture.
+    bool isIndexed = false;
+    uint8_t palette = 0;
+    // Grid atlases only, packed atlases address their regions by index.
+    int tileSize = 0;
+    int tilesPerRow = 1;
+    // Min and max texture coordinates of every tile, read by the sprite shaders. In a tile array each tile has its own
+    // layer and the rect only covers the part a smaller region fills.
+    std::vector<glm::vec4> tileRects;
+    GLuint tileRectBuffer = 0;
+    // Worst opacity of each tile over all its mip levels, also read by the tile array fragment shaders.
+    std::vector<TileOpacity> tileOpacities;
+    GLuint tileOpacityBuffer = 0;
+    bool hasTranslucentTiles = false;
+};
+
+struct SpriteRendererStatistics {
+    float prepareMilliseconds = 0.f;
+    // Part of prepareMilliseconds spent writing instances.
+    float instanceBuildMilliseconds = 0.f;
+    float submitMilliseconds = 0.f;
+    uint32_t instanceCount = 0;
+    uint32_t visibleInstanceCount = 0;
+    uint32_t drawRunCount = 0;
+    uint32_t materialBindCount = 0;
+    uint32_t tileLayerCount = 0;
+    uint32_t tileMeshQuadCount = 0;
+    uint32_t uploadedBytes = 0;
+    uint32_t bytesPerInstance = 0;
+    uint32_t resortedKeys = 0;
+    uint32_t staticInstanceCount = 0;
+    uint32_t staticChunkCount = 0;
+    // Samples that passed the depth test in the previous counted frame, see SetFragmentCountingEnabled.
+    uint32_t fragmentCount = 0;
+    // GL state changes requested by the last Submit(), and how many of them the state cache dropped.
+    uint32_t stateCallCount = 0;
+    uint32_t redundantStateCallCount = 0;
+};
+
+struct SpriteSortTimings {
+    float comparatorMilliseconds = 0.f;
+    float radixMilliseconds = 0.f;
+    float insertionMilliseconds = 0.f;
+};
+
 class SpriteRenderer {
 private:
+    static constexpr GLuint matrixBindingIndex = 1;
+    static constexpr GLuint tileBindingIndex = 2;
+    static constexpr GLuint compactInstanceBindingIndex = 1;
+    static constexpr GLuint culledSlotBindingIndex = 1;
+    // Shader storage binding of the bound material's tile rects.
+    static constexpr GLuint tileRectBlockBinding = 2;
+    static constexpr GLuint tileOpacityBlockBinding = 7;
+    // Indexed materials sample their R8UI atlas on one unit and the palettes on another, unit 1 holds tile layer cells.
+    static constexpr GLuint indexTextureUnit = 2;
+    static constexpr GLuint paletteTextureUnit = 3;
+    // Palette rows fit the bits of SpriteInstance::flags above the transform flags, row 0 is never used.
+    static constexpr uint8_t maxPalettes = spriteInstancePaletteCount;
+    struct CameraBlock {
+        glm::mat4 projection;
+        glm::mat4 view;
+    };
+    // Shared by every sprite shader, each is checked against these when it is created.
+    static constexpr UniformBlock<CameraBlock> cameraBlock = {"TransformationMatrices", 0};
+    static constexpr UniformBlock<std::array<glm::vec4, maxRenderLayers>> renderLayerBlock = {"RenderLayers", 1};
+
+    // Which texels a draw keeps, passed to the fragment shaders as alphaMode.
+    enum class AlphaMode : int {
+        OpaqueTexels,
+        TranslucentTexels,
+        VisibleTexels
+    };
+
+    // Prepare() works on the members from here down to drawFrame and makes no GL calls. Submit() works on the GL
+    // objects after drawFrame. Materials are set up front and only read afterwards, so the two halves can run on
+    // different threads.
+
+    // Compact instances until a sprite gets a transform they cannot express. The renderer goes back to them once no
+    // sprite has needed a matrix for compactInstanceReturnFrames frames in a row.
+    static constexpr uint32_t compactInstanceReturnFrames = 60;
+    bool useCompactInstances;
+    uint32_t framesWithoutMatrixInstances;
+    std::vector<class SpriteNode*> nodes;
+    // Draw order key of every node, kept in the same order as nodes.
+    std::vector<uint64_t> sortKeys;
+    std::vector<uint64_t> sortKeyScratch;
+    std::vector<SpriteNode*> nodeScratch;
+    uint32_t nextSortId;
+    bool hasRemovedNodes;
+    bool areSortKeysStale;
+
+    // Opaque and alpha-tested sprites are drawn first, front to back with depth writes, so hidden fragments fail the
+    // depth test. Only translucent sprites are blended back to front.
+    bool isOpaquePassEnabled;
+
+    bool isCountingFragments;
+
+    glm::mat4 cameraProjection;
+    glm::mat4 cameraView;
+
+    // CPU copy of the instance buffer contents and the node each slot was written for. A slot is only uploaded again
+    // when its node moved, changed or was replaced, so static tiles cost nothing after the first frame.
+    std::vector<glm::mat4> instanceMatrices;
+    // Tile index, and the render layer with the palette in the bits above it.
+    std::vector<glm::ivec2> instanceTiles;
+    std::vector<SpriteInstance> compactInstances;
+    std::vector<SpriteNode*> uploadedNodes;
+    // Slots whose sprite was swapped since the last Draw().
+    std::vector<uint32_t> spriteDirtySlots;
+
+    // Instances are built in ranges of instanceBuildBatchSize slots, in parallel when there is a job system. A range
+    // only writes its own slots and its own cache line aligned entry here, so the jobs need no locks and only meet at
+    // the ends of their slot ranges. The grid is updated afterwards on the calling thread.
+    struct alignas(64) InstanceBuildRange {
+        std::vector<InstanceRange> instanceRanges;
+        std::vector<InstanceRange> tileRanges;
+        std::vector<uint32_t> movedSlots;
+        // Where the range's bytes start in the frame.
+        GLsizeiptr instanceByteOffset = 0;
+        GLsizeiptr tileByteOffset = 0;
+        bool hasPromotionCandidates = false;
+        bool needsMatrixInstances = false;
+        // Nodes of the range with needsMatrixInstance set, only counted with matrix instances.
+        uint32_t matrixInstanceCount = 0;
+    };
+    static constexpr uint32_t instanceBuildBatchSize = 4096;
+    class JobSystem* jobSystem;
+    std::vector<InstanceBuildRange> instanceBuildRanges;
+
+    // Visible slots are drawn as runs of consecutive instances with one material, one indirect command per run, so
+    // culling keeps the depth order and the instance buffers stay untouched. Commands of the opaque part come first. Their
+    // sort keys put material above depth, so without culling each material is a single command.
+    SpriteGrid grid;
+    Bounds2D viewBounds;
+    bool hasViewBounds;
+    bool isCullingEnabled;
+
+    // Compact instances can instead be culled in a compute pass. The commands then cover every slot of their run and
+    // the pass shrinks them to the visible slots, which the culled shader looks up in the instance buffer.
+    bool isGpuCullingEnabled;
+
+    // Drawn in between the sprites, at the position their depth takes in the sorted instance order.
+    std::vector<class TileLayer*> tileLayers;
+    uint32_t nextTileLayerId;
+    // Ids of layers removed since the last Prepare(), their BakedTileLayer is deleted by the next Submit().
+    std::vector<uint32_t> removedTileLayers;
+
+    // Offset of every render layer, added in the vertex shaders. Sprites in a layer keep layer-space transforms, so
+    // scrolling the layer uploads one vec4 instead of dirtying every sprite in it. Layer 0 is the world.
+    std::array<glm::vec4, maxRenderLayers> renderLayerOffsets;
+    std::array<bool, maxRenderLayers> isRenderLayerUsed;
+    bool areRenderLayerOffsetsDirty;
+
+    // Sprites that stopped changing, one batch per material, render layer and depth. They leave nodes entirely, so
+    // sorting, uploads and the grid only see the sprites that still move.
+    std::map<uint64_t, std::unique_ptr<class StaticSpriteBatch>> staticBatches;
+    bool hasPromotionCandidates;
+    // Baked sprites that moved or changed since the last Prepare(), queued by MarkSpriteDirty().
+    std::vector<SpriteNode*> demotedNodes;
+    bool hasRemovedStaticNodes;
+
+    // Written by both halves, GetStatistics() returns a copy.
+    SpriteRendererStatistics statistics;
+    mutable std::mutex statisticsMutex;
+    // The frame Draw() prepares and submits.
+    SpriteFrame drawFrame;
+
+    std::unique_ptr<class GlStateCache> stateCache;
     std::unique_ptr<class VAOWrapper> tileVAO;
     std::unique_ptr<class ShaderWrapper> shader;
-    std::vector<class SpriteNode*> nodes;
+    // Same quad with the SpriteInstance layout.
+    std::unique_ptr<VAOWrapper> compactTileVAO;
+    std::unique_ptr<ShaderWrapper> compactShader;
+
+    std::unique_ptr<class InstanceRingBuffer> matrixBuffer;
+    std::unique_ptr<class InstanceRingBuffer> tileBuffer;
+    std::unique_ptr<InstanceRingBuffer> compactInstanceBuffer;
+    std::unique_ptr<InstanceRingBuffer> drawCommandBuffer;
+    // What the instance buffers hold, patched with the changed bytes of each submitted frame. Dirty bytes are copied
+    // twice before they reach the ring buffer, into SpriteFrame::instanceBytes and into this mirror: the simulation
+    // cannot write mapped regions the render thread picks and fences, and a region that fell behind is refreshed from
+    // a complete copy.
+    std::vector<std::byte> submittedInstances;
+    std::vector<std::byte> submittedTiles;
+    GLuint cameraBuffer;
+    // Matrices in cameraBuffer.
+    glm::mat4 submittedProjection;
+    glm::mat4 submittedView;
+    GLuint renderLayerBuffer;
+
+    std::unique_ptr<class GpuSpriteCuller> gpuCuller;
+    std::unique_ptr<VAOWrapper> culledTileVAO;
+    std::unique_ptr<ShaderWrapper> culledShader;
+
+    std::unique_ptr<VAOWrapper> layerVAO;
+    std::unique_ptr<ShaderWrapper> layerShader;
+    std::unique_ptr<ShaderWrapper> meshShader;
+
+    std::map<uint64_t, std::unique_ptr<class BakedSpriteBatch>> bakedBatches;
+    std::map<uint32_t, std::unique_ptr<class BakedTileLayer>> bakedTileLayers;
 
-    GLuint matrixBuffer, textureCordBuffer;
+    std::array<GLuint, 2> fragmentQueries;
+    std::array<bool, 2> isFragmentQueryPending;
+    uint32_t fragmentQueryIndex;
 
-    GLuint tileMap;
-    int tileSize;
-    int tileMapSize;
+    // Counted while submitting, copied into statistics at the end.
+    uint32_t materialBindCount;
+    uint32_t tileMeshQuadCount;
+    uint32_t fragmentCount;
+
+    // Material 0 is the atlas the renderer was created with, tile layers always use it.
+    std::vector<SpriteMaterial> materials;
+    // One row of 256 colours per palette.
+    GLuint paletteTexture;
+    uint8_t paletteCount;
+    // Atlases are split into a GL_TEXTURE_2D_ARRAY with one layer per tile. Tiles cannot bleed into each other, so the
+    // shaders sample (uv, tile index) without clamping and the texture can use mipmaps.
+    bool useTileArray;
 
 
 public:
-    SpriteRenderer(std::string tileMapPath, int tileSize);
+    SpriteRenderer(std::string tileMapPath, int tileSize, bool useTileArray = true);
 
+    // Prepare() and Submit() in one go.
     void Draw();
+    // Sorts, culls and batches the sprites into frame without any GL calls.
+    void Prepare(SpriteFrame& frame);
+    // Uploads and draws a prepared frame. Needs the GL context, frames have to be submitted in the order they were
+    // prepared.
+    void Submit(const SpriteFrame& frame);
 
     void AddNode(SpriteNode* node);
     void RemoveNode(SpriteNode* node);
+    void MarkSpriteDirty(SpriteNode* node);
+
+    // Loads another grid atlas, sprites refer to it through Sprite::GetMaterial(). Returns 0 if it cannot be loaded.
+    // Materials and palettes need the GL context, add them before the scene is drawn on another thread.
+    uint16_t AddMaterial(const std::string& texturePath, int tileSize);
+    // Uses a packed atlas as a material, a sprite's tile map position is then (region index, 0).
+    uint16_t AddMaterial(const class TextureAtlas& atlas);
+    // Uploads the atlas again after regions were packed into it at runtime.
+    void UpdateMaterial(uint16_t material, const TextureAtlas& atlas);
+    // Palettes are variants of an indexed atlas' palette, a sprite node picks one with SpriteNode::SetPalette().
+    // Returns 0 when all rows are taken.
+    uint8_t AddPalette(const class Palette& palette);
+    void SetPalette(uint8_t palette, const Palette& colors);
+
+    void AddTileLayer(TileLayer* layer);
+    void RemoveTileLayer(TileLayer* layer);
+    [[nodiscard]] uint16_t GetTileIndex(glm::ivec2 tileCoord, uint16_t material = 0) const;
+    [[nodiscard]] GLuint GetQuadIndexCount() const;
+    [[nodiscard]] TileOpacity GetTileOpacity(uint16_t tileIndex, uint16_t material = 0) const;
+
+    // Off draws every sprite blended back to front, for comparison.
+    void SetOpaquePassEnabled(bool isEnabled);
+    [[nodiscard]] bool IsOpaquePassEnabled() const;
+    // Counts the samples each Draw() writes with a GL_SAMPLES_PASSED query, read back one frame later.
+    void SetFragmentCountingEnabled(bool isEnabled);
+
+    // Returns 0, the world layer, when every layer is taken.
+    uint8_t AddRenderLayer();
+    void RemoveRenderLayer(uint8_t layer);
+    void SetRenderLayerOffset(uint8_t layer, glm::vec2 offset);
+
+    // Builds instances on the job system's workers, Prepare() must then run on the thread that owns it. Null builds
+    // them on the calling thread.
+    void SetJobSystem(JobSystem* jobSystem);
+
+    void SetViewBounds(const Bounds2D& bounds);
+    // Written into the TransformationMatrices block when the frame is submitted.
+    void SetCameraMatrices(const glm::mat4& projection, const glm::mat4& view);
+    void SetCullingEnabled(bool isEnabled);
+    [[nodiscard]] bool IsCullingEnabled() const;
+    // Culls sprites on the GPU while compact instances are used, the CPU grid still culls everything else.
+    void SetGpuCullingEnabled(bool isEnabled);
+    [[nodiscard]] bool IsGpuCullingEnabled() const;
+    // Waits for the GPU cull of the last Submit(). The statistics only have the count of the newest cull the GPU had
+    // finished, usually a frame or two old.
+    [[nodiscard]] uint32_t ReadGpuVisibleInstanceCount() const;
+
+    [[nodiscard]] SpriteRendererStatistics GetStatistics() const;
+
+    // Sorts spriteCount random depths with the old matrix comparator, with a full radix sort, and with an insertion
+    // sort after a handful of keys changed.
+    static SpriteSortTimings MeasureSortTimes(uint32_t spriteCount);
 
     virtual ~SpriteRenderer();
 
 private:
-    void UpdateMatrixBuffer();
-    void UpdateTilePositionBuffer();
+    void PromoteStaticNodes();
+    void DemoteStaticNodes(SpriteFrame& frame);
+    void CompactNodes();
+    [[nodiscard]] uint64_t MakeNodeSortKey(const SpriteNode* node, uint32_t id) const;
+    uint32_t UpdateSortKeys();
+    void SortNodes(uint32_t changedKeys);
+    // Records the changed instance bytes in frame.
+    void UpdateInstanceBuffers(SpriteFrame& frame);
+    // Writes the instances of slots [begin, end), one job of UpdateInstanceBuffers().
+    void BuildInstanceRange(uint32_t begin, uint32_t end);
+    void UseMatrixInstances();
+    void UseCompactInstances();
+    // Runs never cross a split, so the slots between two splits map to a contiguous range of commands.
+    void WriteDrawCommands(SpriteFrame& frame, GLuint indexCount, const FrameVector<uint32_t>& splits,
+                           bool isCulling);
+
+    // Applies the changed instance bytes and writes the instance buffers. Returns the number of bytes uploaded.
+    GLsizeiptr UploadInstances(const SpriteFrame& frame);
+    // Expects either exactly the opaque part or a range of translucent slots.
+    void DrawSpriteSlots(const SpriteFrame& frame, uint32_t begin, uint32_t end, AlphaMode alphaMode);
+    // Binds the material's texture and tile rects and tells the sprite shader whether the material is indexed.
+    void BindMaterial(const ShaderWrapper& spriteShader, uint16_t material);
+    bool DrawTileLayer(const SpriteFrame& frame, const SpriteFramePass& pass, const BakedTileLayer& layer,
+                       AlphaMode alphaMode);
+    void DrawStaticBatch(const SpriteFrame& frame, const BakedSpriteBatch& batch, AlphaMode alphaMode);
+    void ReadFragmentCount();
+    static Bounds2D GetNodeBounds(const SpriteNode* node);
+    // View bounds moved into the space of a render layer.
+    [[nodiscard]] static Bounds2D GetLayerViewBounds(const SpriteFrame& frame, uint8_t layer);
+    [[nodiscard]] uint16_t GetTileIndex(const SpriteNode* node) const;
+    [[nodiscard]] uint16_t GetNodeMaterial(const SpriteNode* node) const;
 
     void InitializeVAO();
 
-    GLuint TextureFromFile(const std::string& path);
+    bool TextureFromFile(const std::string& path, SpriteMaterial& material);
+    void UploadAtlas(const TextureAtlas& atlas, SpriteMaterial& material);
+    // Uploads the tile rects and opacities the shaders read.
+    static void UploadTileBuffers(SpriteMaterial& material);
+    static void ClassifyTiles(SpriteMaterial& material, const unsigned char* pixels, int width, int height,
+                              int componentCount);
+    // Pixels are bottom row first, position is the bottom left corner of the rect.
+    static TileOpacity ClassifyRect(const unsigned char* pixels, int width, int componentCount, glm::ivec2 position,
+                                    glm::ivec2 size);
+    static void UploadTileArray(SpriteMaterial& material, const unsigned char* pixels, int width, int height,
+                                int componentCount, GLenum colorFormat);
+    // Builds and uploads the mip levels below level 0 of one layer of the bound tile array and returns the worst
+    // opacity among them. Levels of opaque and alpha-tested layers keep the alpha coverage of level 0.
+    static TileOpacity UploadMipLevels(std::vector<unsigned char> texels, glm::ivec2 size, int componentCount,
+                                       GLint layer, GLenum format, TileOpacity opacity);
+    // Snaps alpha to 0 or 255 so that as many texels as possible stay visible as in coverage, the share of level 0
+    // texels at or above half alpha.
+    static void PreserveAlphaCoverage(std::vector<unsigned char>& texels, float coverage);
 
 };
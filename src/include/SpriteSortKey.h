@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+// Draw order packed into one integer: layer, then depth, then material, then a stable id, so sprites with equal
+// depth keep their order between frames and the whole comparison is a single integer compare.
+constexpr uint32_t spriteSortLayerBits = 6;
+constexpr uint32_t spriteSortDepthBits = 24;
+constexpr uint32_t spriteSortMaterialBits = 10;
+constexpr uint32_t spriteSortIdBits = 24;
+
+constexpr uint64_t spriteSortIdMask = (uint64_t(1) << spriteSortIdBits) - 1;
+constexpr uint32_t spriteSortMaterialMask = (1u << spriteSortMaterialBits) - 1;
+
+// Maps a float to an unsigned integer with the same ordering, keeping the most significant spriteSortDepthBits bits.
+constexpr uint32_t SpriteSortDepth(float depth) {
+    uint32_t bits = std::bit_cast<uint32_t>(depth);
+    bits ^= (bits & 0x80000000u) ? 0xFFFFFFFFu : 0x80000000u;
+    return bits >> (32 - spriteSortDepthBits);
+}
+
+constexpr uint64_t MakeSpriteSortKey(uint32_t layer, float depth, uint32_t material, uint32_t id) {
+    uint64_t key = layer & ((1u << spriteSortLayerBits) - 1);
+    key = (key << spriteSortDepthBits) | SpriteSortDepth(depth);
+    key = (key << spriteSortMaterialBits) | (material & spriteSortMaterialMask);
+    key = (key << spriteSortIdBits) | (id & spriteSortIdMask);
+    return key;
+}
+
+constexpr uint32_t SpriteSortMaterial(uint64_t key) {
+    return static_cast<uint32_t>(key >> spriteSortIdBits) & spriteSortMaterialMask;
+}
+
+// Same fields with material above depth, for sprites whose order across materials does not matter. Each material is
+// then one run of slots, still in depth order within it.
+constexpr uint64_t MakeMaterialFirstSortKey(uint32_t layer, float depth, uint32_t material, uint32_t id) {
+    uint64_t key = layer & ((1u << spriteSortLayerBits) - 1);
+    key = (key << spriteSortMaterialBits) | (material & spriteSortMaterialMask);
+    key = (key << spriteSortDepthBits) | SpriteSortDepth(depth);
+    key = (key << spriteSortIdBits) | (id & spriteSortIdMask);
+    return key;
+}
+
+constexpr uint32_t MaterialFirstSortMaterial(uint64_t key) {
+    return static_cast<uint32_t>(key >> (spriteSortIdBits + spriteSortDepthBits)) & spriteSortMaterialMask;
+}
+
+// Sorts keys and values together with std::sort on an index permutation.
+template<typename Value>
+void SortByKey(std::vector<uint64_t>& keys, std::vector<Value>& values) {
+    std::vector<uint32_t> order(keys.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [&keys](uint32_t a, uint32_t b) {
+        return keys[a] < keys[b];
+    });
+
+    std::vector<uint64_t> sortedKeys(keys.size());
+    std::vector<Value> sortedValues(values.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        sortedKeys[i] = keys[order[i]];
+        sortedValues[i] = std::move(values[order[i]]);
+    }
+    keys.swap(sortedKeys);
+    values.swap(sortedValues);
+}
+
+// Cheap when only a few keys are out of place, the cost grows with how far they have to travel. Once the keys have
+// moved further than keys.size() slots in total it finishes with SortByKey, so it never degrades to O(k * n).
+template<typename Value>
+void InsertionSortByKey(std::vector<uint64_t>& keys, std::vector<Value>& values) {
+    size_t shiftBudget = keys.size();
+    for (size_t i = 1; i < keys.size(); i++) {
+        uint64_t key = keys[i];
+        if (keys[i - 1] <= key)
+            continue;
+
+        size_t j = i;
+        while (j > 0 && keys[j - 1] > key)
+            j--;
+        if (i - j > shiftBudget) {
+            SortByKey(keys, values);
+            return;
+        }
+        shiftBudget -= i - j;
+
+        Value value = std::move(values[i]);
+        std::move_backward(keys.begin() + j, keys.begin() + i, keys.begin() + i + 1);
+        std::move_backward(values.begin() + j, values.begin() + i, values.begin() + i + 1);
+        keys[j] = key;
+        values[j] = std::move(value);
+    }
+}
+
+// LSD radix sort over bytes. Passes where every key has the same byte are skipped, so unused layer and material
+// bits cost nothing. The scratch vectors are kept by the caller to avoid reallocating every frame.
+template<typename Value>
+void RadixSortByKey(std::vector<uint64_t>& keys, std::vector<Value>& values,
+                    std::vector<uint64_t>& keyScratch, std::vector<Value>& valueScratch) {
+    constexpr uint32_t passCount = sizeof(uint64_t);
+    if (keys.empty())
+        return;
+
+    std::array<std::array<uint32_t, 256>, passCount> histograms{};
+    for (uint64_t key : keys) {
+        for (uint32_t pass = 0; pass < passCount; pass++)
+            histograms[pass][(key >> (pass * 8)) & 0xFF]++;
+    }
+
+    keyScratch.resize(keys.size());
+    valueScratch.resize(values.size());
+
+    for (uint32_t pass = 0; pass < passCount; pass++) {
+        std::array<uint32_t, 256>& histogram = histograms[pass];
+        if (histogram[(keys[0] >> (pass * 8)) & 0xFF] == keys.size())
+            continue;
+
+        uint32_t offset = 0;
+        for (uint32_t& count : histogram) {
+            uint32_t bucketSize = count;
+            count = offset;
+            offset += bucketSize;
+        }
+
+        for (size_t i = 0; i < keys.size(); i++) {
+            uint32_t destination = histogram[(keys[i] >> (pass * 8)) & 0xFF]++;
+            keyScratch[destination] = keys[i];
+            valueScratch[destination] = std::move(values[i]);
+        }
+
+        keys.swap(keyScratch);
+        values.swap(valueScratch);
+    }
+}
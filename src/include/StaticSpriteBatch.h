@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <vector>
+#include <glad/glad.h>
+
+#include "Bounds2D.h"
+#include "SpriteFrame.h"
+
+// Sprites of one material at one depth and render layer that stopped changing. Their instances are baked chunk by
+// chunk together with one indirect command per chunk into GL_STATIC_DRAW buffers, so drawing them needs no per-frame
+// uploads. The bake is only redone when a sprite joins or leaves the batch. This is the scene side, BakedSpriteBatch
+// holds the buffers.
+class StaticSpriteBatch {
+private:
+    struct Chunk {
+        std::vector<class SpriteNode*> nodes;
+    };
+
+    float depth;
+    uint8_t layer;
+    uint16_t material;
+    std::map<uint64_t, Chunk> chunks;
+
+    uint32_t nodeCount;
+    bool isDirty;
+
+public:
+    static constexpr float chunkSize = 32.f;
+
+    StaticSpriteBatch(float depth, uint8_t layer, uint16_t material);
+
+    StaticSpriteBatch(const StaticSpriteBatch&) = delete;
+    StaticSpriteBatch& operator=(const StaticSpriteBatch&) = delete;
+
+    void Add(SpriteNode* node);
+    void Remove(SpriteNode* node);
+
+    template<typename Function>
+    void ForEachNode(Function&& function) const;
+
+    // Bakes the instances and commands into upload if a sprite joined or left since the last bake, returns false
+    // otherwise.
+    bool Rebuild(const class SpriteRenderer& renderer, StaticBatchUpload& upload);
+
+    [[nodiscard]] float GetDepth() const;
+    [[nodiscard]] uint8_t GetRenderLayer() const;
+    [[nodiscard]] uint16_t GetMaterial() const;
+    [[nodiscard]] uint32_t GetNodeCount() const;
+    [[nodiscard]] uint32_t GetChunkCount() const;
+    [[nodiscard]] bool IsEmpty() const;
+
+private:
+    static uint64_t GetChunkKey(const SpriteNode* node);
+};
+
+// The buffers of a baked StaticSpriteBatch, owned by whichever thread draws.
+class BakedSpriteBatch {
+private:
+    GLuint instanceBuffer;
+    GLuint commandBuffer;
+    uint16_t material;
+    uint8_t layer;
+    // Bounds of every baked chunk, in command order.
+    std::vector<Bounds2D> commandBounds;
+
+public:
+    BakedSpriteBatch();
+    ~BakedSpriteBatch();
+
+    BakedSpriteBatch(const BakedSpriteBatch&) = delete;
+    BakedSpriteBatch& operator=(const BakedSpriteBatch&) = delete;
+
+    void Upload(const StaticBatchUpload& upload);
+    // Draws the chunks overlapping cullBounds, given in layer space, or every chunk without bounds. Expects the compact
+    // sprite shader and vertex array to be bound.
+    void Draw(GLuint instanceBindingIndex, const Bounds2D* cullBounds) const;
+
+    [[nodiscard]] uint16_t GetMaterial() const;
+    [[nodiscard]] uint8_t GetRenderLayer() const;
+};
+
+template<typename Function>
+void StaticSpriteBatch::ForEachNode(Function&& function) const {
+    for (const auto& [key, chunk] : chunks) {
+        for (SpriteNode* node : chunk.nodes)
+            function(node);
+    }
+}
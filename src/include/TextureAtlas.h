@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <iosfwd>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Palette.h"
+#include "SkylinePacker.h"
+
+struct AtlasRegion {
+    std::string name;
+    // Bottom left corner and size in pixels, without the padding.
+    glm::ivec2 position;
+    glm::ivec2 size;
+    // Min and max texture coordinates.
+    glm::vec4 uvRect;
+};
+
+// Loose images packed into one RGBA texture. Cooked offline into an image and a lookup table, or packed at runtime for
+// images that are loaded late. Regions are only ever appended, so a region index stays valid for the atlas' lifetime.
+// Pixels are stored bottom row first, the way the renderer loads its textures.
+class TextureAtlas {
+private:
+    glm::ivec2 size;
+    int padding;
+    std::vector<unsigned char> pixels;
+    SkylinePacker packer;
+    std::vector<AtlasRegion> regions;
+    std::unordered_map<std::string, uint16_t> regionIndices;
+
+    // Set for palette indexed atlases, one index per pixel in the same order as pixels.
+    std::optional<Palette> palette;
+    std::vector<uint8_t> indices;
+
+public:
+    explicit TextureAtlas(glm::ivec2 size, int padding = 1);
+
+    // Both return the region index, or nothing if the image cannot be loaded or there is no room left for it.
+    std::optional<uint16_t> AddImage(const std::string& name, const std::string& path);
+    std::optional<uint16_t> AddPixels(const std::string& name, const unsigned char* rgbaPixels, glm::ivec2 imageSize);
+
+    // Quantizes the atlas, and every image added later, to the palette.
+    void SetPalette(const Palette& newPalette);
+
+    // Writes basePath.tga and the lookup table basePath.atlas, one "x y width height u0 v0 u1 v1 name" line per region.
+    // Indexed atlases also write the indices as an 8 bit basePath.indexed.tga and their colours into the table.
+    bool Save(const std::string& basePath) const;
+    // Replaces the atlas with a saved one. Regions added afterwards are packed around the loaded ones.
+    bool Load(const std::string& basePath);
+
+    [[nodiscard]] std::optional<uint16_t> FindRegion(const std::string& name) const;
+    [[nodiscard]] const std::vector<AtlasRegion>& GetRegions() const;
+    [[nodiscard]] glm::ivec2 GetSize() const;
+    [[nodiscard]] const unsigned char* GetPixels() const;
+    [[nodiscard]] bool IsIndexed() const;
+    [[nodiscard]] const Palette* GetPalette() const;
+    [[nodiscard]] const uint8_t* GetIndices() const;
+
+    // The offline cook step: packs every image under sourceDirectory, named by their path relative to it without the
+    // extension, tallest first, and saves the atlas. Quantized when a palette is given.
+    static bool Cook(const std::string& sourceDirectory, const std::string& basePath, glm::ivec2 size,
+                     const Palette* palette = nullptr);
+
+private:
+    void QuantizeRows(int firstRow, int rowCount);
+    bool LoadIndices(const std::string& basePath, std::istringstream& paletteLine);
+    AtlasRegion& PlaceRegion(const std::string& name, glm::ivec2 position, glm::ivec2 regionSize);
+};
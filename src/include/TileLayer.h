@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "SpriteFrame.h"
+
+enum class TileLayerMode {
+    // One quad over the whole layer, the fragment shader looks the tile up in an index texture.
+    IndexTexture,
+    // Greedily merged quads over the occupied cells only, better for sparse layers.
+    GreedyMesh
+};
+
+// A grid of tiles drawn without a node or instance per tile, so the cost of static terrain depends on the pixels
+// it covers instead of the number of tiles. Each cell holds a tile index in the low 13 bits and the
+// SpriteInstanceFlags in the top 3; emptyCell marks a hole. This is the scene side, it hands its cells to the frame
+// and BakedTileLayer holds the GL objects.
+class TileLayer {
+private:
+    TileLayerMode mode;
+    glm::ivec2 size;
+    std::vector<uint16_t> cells;
+
+    // World transform of the node that owns the layer. Cell (x, row) is centered at (x, size.y - row) in that space.
+    const glm::mat4* worldTransform;
+    uint8_t renderLayer;
+
+    // Set by SpriteRenderer::AddTileLayer(), names the BakedTileLayer of the layer.
+    uint32_t id;
+    // Every cell goes into the next upload until the first one was taken, only the changed ones afterwards.
+    bool isUploaded;
+    std::vector<TileCellChange> changedCells;
+
+public:
+    static constexpr uint16_t emptyCell = 0xFFFF;
+    static constexpr uint32_t flagsShift = 13;
+    static constexpr uint16_t maxTileIndex = (1 << flagsShift) - 1;
+
+    // cells holds size.x * size.y values, row 0 is the top row of the grid.
+    TileLayer(glm::ivec2 size, std::vector<uint16_t> cells, const glm::mat4* worldTransform,
+              TileLayerMode mode = TileLayerMode::IndexTexture);
+
+    TileLayer(const TileLayer&) = delete;
+    TileLayer& operator=(const TileLayer&) = delete;
+
+    static uint16_t PackCell(uint16_t tileIndex, uint8_t flags);
+
+    // Only records the change, it reaches the GL objects with the next prepared frame.
+    void SetCell(glm::ivec2 cell, uint16_t value);
+    void SetRenderLayer(uint8_t layer);
+
+    // Moves the cells written since the last call into upload, or all of them the first time. Returns false when
+    // nothing changed.
+    bool TakeUpload(TileLayerUpload& upload);
+
+    [[nodiscard]] TileLayerMode GetMode() const;
+    [[nodiscard]] glm::ivec2 GetSize() const;
+    [[nodiscard]] const glm::mat4& GetWorldTransform() const;
+    [[nodiscard]] float GetDepth() const;
+    [[nodiscard]] uint8_t GetRenderLayer() const;
+    [[nodiscard]] uint32_t GetId() const;
+
+private:
+    void SetId(uint32_t newId);
+
+    friend class SpriteRenderer;
+};
+
+// The GL objects of a TileLayer, owned by whichever thread draws. An index texture or a greedy mesh, by mode.
+class BakedTileLayer {
+private:
+    TileLayerMode mode;
+    GLuint indexTexture;
+    std::unique_ptr<class TileMesh> mesh;
+    glm::ivec2 size;
+    // Kept for rebuilding mesh chunks, empty for index textures.
+    std::vector<uint16_t> cells;
+
+public:
+    BakedTileLayer();
+    ~BakedTileLayer();
+
+    BakedTileLayer(const BakedTileLayer&) = delete;
+    BakedTileLayer& operator=(const BakedTileLayer&) = delete;
+
+    // Creates the texture or mesh from a first upload, patches it from later ones. Mesh chunks touched by the upload
+    // are rebuilt, vertex arrays of new chunks are bound through stateCache.
+    void Upload(const TileLayerUpload& upload, class GlStateCache& stateCache);
+
+    [[nodiscard]] TileLayerMode GetMode() const;
+    [[nodiscard]] const TileMesh* GetMesh() const;
+    [[nodiscard]] GLuint GetIndexTexture() const;
+    [[nodiscard]] glm::ivec2 GetSize() const;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+struct TileMeshVertex {
+    // In cells, x to the right and y downwards from the top row; the fractional part is the position in the tile.
+    glm::vec2 cellPosition;
+    uint16_t cell;
+    uint16_t padding;
+};
+
+// Static geometry for a tile grid. Runs of identical cells (same tile and orientation) are merged greedily into
+// single quads whose cell coordinates repeat the tile across the quad. Built per chunk, so a changed cell only
+// rebuilds the chunk it lives in.
+class TileMesh {
+private:
+    // The GL objects of a chunk are only created once it has a quad, most chunks of a sparse layer never do.
+    struct Chunk {
+        GLuint vao;
+        GLuint vbo;
+        GLsizei vertexCount;
+        bool isDirty;
+    };
+
+    glm::ivec2 size;
+    glm::ivec2 chunkCount;
+    std::vector<Chunk> chunks;
+    uint32_t quadCount;
+    bool hasDirtyChunks;
+
+public:
+    static constexpr int chunkSize = 32;
+
+    explicit TileMesh(glm::ivec2 size);
+    ~TileMesh();
+
+    TileMesh(const TileMesh&) = delete;
+    TileMesh& operator=(const TileMesh&) = delete;
+
+    void MarkCellDirty(glm::ivec2 cell);
+    // Rebuilds every dirty chunk from cells, laid out like TileLayer cells. Vertex arrays of new chunks are bound
+    // through stateCache.
+    void Rebuild(const std::vector<uint16_t>& cells, uint16_t emptyCell, class GlStateCache& stateCache);
+
+    void Draw(class GlStateCache& stateCache) const;
+
+    [[nodiscard]] uint32_t GetQuadCount() const;
+
+    // Appends two triangles per merged quad covering the cells of [origin, origin + extent).
+    static void MergeCells(const std::vector<uint16_t>& cells, glm::ivec2 size, glm::ivec2 origin, glm::ivec2 extent,
+                           uint16_t emptyCell, std::vector<TileMeshVertex>& vertices);
+
+private:
+    static void AllocateChunk(Chunk& chunk, GlStateCache& stateCache);
+};
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtx/quaternion.hpp>
@@ -10,8 +11,9 @@ private:
     glm::vec3 scale;
     glm::quat rotation;
 
-
-    bool isDirty;
+    // Bumped by every setter. Nodes compare it with the version they last applied, a transform shared by clones stays
+    // untouched by them.
+    uint32_t version;
 public:
     Transform();
     Transform(Transform* originalTransform);
@@ -25,6 +27,5 @@ public:
     void SetScale(const glm::vec3& newScale);
 
     [[nodiscard]] glm::mat4 GetMatrix() const;
-
-    friend class Node;
+    [[nodiscard]] uint32_t GetVersion() const;
 };
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+
+enum class UpdatePhase {
+    Input,
+    Gameplay,
+    Physics,
+    Animation,
+    Camera,
+    Late,
+    Count
+};
+
+// Runs registered update methods phase by phase. Every (phase, method) pair gets its own typed list,
+// so a phase is a tight loop of direct calls over one node type and nodes without update logic are never visited.
+class UpdateScheduler {
+private:
+    template<typename Method>
+    struct MethodOwner;
+
+    template<typename Owner, typename Result, typename... Arguments>
+    struct MethodOwner<Result (Owner::*)(Arguments...)> {
+        using Type = Owner;
+    };
+
+    class UpdateListBase {
+    public:
+        virtual ~UpdateListBase() = default;
+        virtual void Run(class MainEngine* engine, float seconds, float deltaSeconds) = 0;
+        virtual void Compact() = 0;
+    };
+
+    template<auto Method>
+    class UpdateList : public UpdateListBase {
+    public:
+        using NodeType = typename MethodOwner<decltype(Method)>::Type;
+
+        // Unregistered nodes are nulled in place, so the running pass skips them, and Compact() drops them in one go.
+        std::vector<NodeType*> nodes;
+        // Nodes registered while Run() iterates nodes, appended once it is done.
+        std::vector<NodeType*> pendingAdditions;
+        // Where each registered node sits in nodes or pendingAdditions, so unregistering is O(1) however many nodes
+        // stop in one pass.
+        std::unordered_map<NodeType*, size_t> nodeIndices;
+        std::unordered_map<NodeType*, size_t> additionIndices;
+        bool isRunning = false;
+        bool hasNulledNodes = false;
+
+        void Run(MainEngine* engine, float seconds, float deltaSeconds) override {
+            Compact();
+
+            isRunning = true;
+            // Indexed, a removal during the pass only nulls its entry.
+            for (size_t i = 0; i < nodes.size(); i++) {
+                if (NodeType* node = nodes[i])
+                    (node->*Method)(engine, seconds, deltaSeconds);
+            }
+            isRunning = false;
+
+            Compact();
+        }
+
+        void Add(NodeType* node) {
+            if (!isRunning) {
+                nodeIndices[node] = nodes.size();
+                nodes.push_back(node);
+                return;
+            }
+
+            additionIndices[node] = pendingAdditions.size();
+            pendingAdditions.push_back(node);
+        }
+
+        // The index entry goes right away, so a new node can reuse the address before the list is compacted.
+        void Remove(NodeType* node) {
+            if (auto addition = additionIndices.find(node); addition != additionIndices.end()) {
+                pendingAdditions[addition->second] = nullptr;
+                additionIndices.erase(addition);
+                return;
+            }
+
+            if (auto entry = nodeIndices.find(node); entry != nodeIndices.end()) {
+                nodes[entry->second] = nullptr;
+                nodeIndices.erase(entry);
+                hasNulledNodes = true;
+            }
+        }
+
+        void Compact() override {
+            if (hasNulledNodes) {
+                std::erase(nodes, nullptr);
+                for (size_t i = 0; i < nodes.size(); i++)
+                    nodeIndices[nodes[i]] = i;
+                hasNulledNodes = false;
+            }
+
+            for (NodeType* node : pendingAdditions) {
+                if (node == nullptr)
+                    continue;
+                nodeIndices[node] = nodes.size();
+                nodes.push_back(node);
+            }
+            pendingAdditions.clear();
+            additionIndices.clear();
+        }
+    };
+
+    std::array<std::vector<std::unique_ptr<UpdateListBase>>, static_cast<size_t>(UpdatePhase::Count)> phases;
+
+public:
+    // Safe to call from update methods. Nodes registered to the list that is running join it once the list is done,
+    // nodes unregistered from it are not called again in the same pass.
+    template<auto Method>
+    void Register(UpdatePhase phase, typename MethodOwner<decltype(Method)>::Type* node);
+
+    template<auto Method>
+    void Unregister(UpdatePhase phase, typename MethodOwner<decltype(Method)>::Type* node);
+
+    void Run(MainEngine* engine, float seconds, float deltaSeconds);
+    void Compact();
+
+private:
+    template<auto Method>
+    UpdateList<Method>* FindList(UpdatePhase phase);
+};
+
+template<auto Method>
+UpdateScheduler::UpdateList<Method>* UpdateScheduler::FindList(UpdatePhase phase) {
+    for (auto& list : phases[static_cast<size_t>(phase)]) {
+        if (auto* typedList = dynamic_cast<UpdateList<Method>*>(list.get()))
+            return typedList;
+    }
+    return nullptr;
+}
+
+template<auto Method>
+void UpdateScheduler::Register(UpdatePhase phase, typename MethodOwner<decltype(Method)>::Type* node) {
+    UpdateList<Method>* list = FindList<Method>(phase);
+    if (list == nullptr) {
+        auto newList = std::make_unique<UpdateList<Method>>();
+        list = newList.get();
+        phases[static_cast<size_t>(phase)].push_back(std::move(newList));
+    }
+
+    list->Add(node);
+}
+
+template<auto Method>
+void UpdateScheduler::Unregister(UpdatePhase phase, typename MethodOwner<decltype(Method)>::Type* node) {
+    UpdateList<Method>* list = FindList<Method>(phase);
+    if (list == nullptr)
+        return;
+
+    list->Remove(node);
+}
@@ -1,15 +1,51 @@
+#include <cstring>
+
 #include "MainEngine.h"
 #include "LoggingMacros.h"
+#include "TextureAtlas.h"
 
-int main(int, char**)
+int main(int argc, char** argv)
 {
     LoggingMacros::InitializeSPDLog();
 
+    // --cook-atlas packs the loose images under res/textures into res/textures/Atlas.tga and its lookup table.
+    // With --indexed the atlas is quantized to the pixel art palette and its indices are saved next to it.
+    if (argc > 1 && std::strcmp(argv[1], "--cook-atlas") == 0) {
+        if (argc > 2 && std::strcmp(argv[2], "--indexed") == 0) {
+            Palette palette;
+            if (!palette.LoadFromFile("res/textures/PixelArt/ColorPallete.txt"))
+                return 1;
+            return TextureAtlas::Cook("res/textures", "res/textures/Atlas", glm::ivec2(2048), &palette) ? 0 : 1;
+        }
+        return TextureAtlas::Cook("res/textures", "res/textures/Atlas", glm::ivec2(2048)) ? 0 : 1;
+    }
+
+    // --measure-overdraw renders a fixed number of frames in a hidden window and prints the fragment counts.
+    bool isMeasuringOverdraw = argc > 1 && std::strcmp(argv[1], "--measure-overdraw") == 0;
+    // --verify-gpu-culling compares CPU and GPU culled frames in a hidden window, fails if they differ.
+    bool isVerifyingGpuCulling = argc > 1 && std::strcmp(argv[1], "--verify-gpu-culling") == 0;
+    // --measure-render-thread prints the frame time under a heavy GL load with and without the render thread.
+    bool isMeasuringRenderThread = argc > 1 && std::strcmp(argv[1], "--measure-render-thread") == 0;
+    // --measure-instance-building moves 250k sprites and prints the instance build time with 1 to 8 cores.
+    bool isMeasuringInstanceBuilding = argc > 1 && std::strcmp(argv[1], "--measure-instance-building") == 0;
+
     MainEngine Engine = MainEngine();
-    if(Engine.Init() == 0)
+    bool isOffscreen = isMeasuringOverdraw || isVerifyingGpuCulling || isMeasuringRenderThread
+                       || isMeasuringInstanceBuilding;
+    if(Engine.Init(isOffscreen) == 0)
     {
         Engine.PrepareScene();
-        int32_t ReturnCode = Engine.MainLoop();
+        int32_t ReturnCode;
+        if (isMeasuringOverdraw)
+            ReturnCode = Engine.MeasureOverdraw(300);
+        else if (isVerifyingGpuCulling)
+            ReturnCode = Engine.VerifyGpuCulling(120);
+        else if (isMeasuringRenderThread)
+            ReturnCode = Engine.MeasureRenderThread(300);
+        else if (isMeasuringInstanceBuilding)
+            ReturnCode = Engine.MeasureInstanceBuilding(250000, 120);
+        else
+            ReturnCode = Engine.MainLoop();
 
         if (ReturnCode != 0) {
             return ReturnCode;
@@ -1,21 +1,10 @@
 #include "Camera.h"
-#include "glad/glad.h"
-#include "glm/gtc/type_ptr.hpp"
+#include "glm/gtc/matrix_transform.hpp"
 
 #include "LoggingMacros.h"
 
 Camera::Camera()
-        : position(0.f, 0.f, 50.f), scale(40.f) {
-    uboTransformMatrices = 0;
-    glGenBuffers(1, &uboTransformMatrices);
-    glBindBuffer(GL_UNIFORM_BUFFER, uboTransformMatrices);
-    glBufferData(GL_UNIFORM_BUFFER, 2 * sizeof(glm::mat4), nullptr, GL_DYNAMIC_DRAW);
-    glBindBufferBase(GL_UNIFORM_BUFFER, 0, uboTransformMatrices);
-    UpdateView();
-}
-
-Camera::~Camera() {
-    glDeleteBuffers(1, &uboTransformMatrices);
+        : position(0.f, 0.f, 50.f), scale(40.f), Resolution(0, 0) {
 }
 
 glm::mat4 Camera::GetCameraProjectionMatrix(glm::vec<2, int> resolution) const {
@@ -26,23 +15,25 @@ glm::mat4 Camera::GetCameraProjectionMatrix(glm::vec<2, int> resolution) const {
 }
 
 void Camera::UpdateProjection(glm::vec<2, int> resolution) {
-    glBindBuffer(GL_UNIFORM_BUFFER, uboTransformMatrices);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::mat4), glm::value_ptr(GetCameraProjectionMatrix(resolution)));
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    Resolution = resolution;
+}
+
+glm::mat4 Camera::GetProjectionMatrix() const {
+    return GetCameraProjectionMatrix(Resolution);
 }
 
-void Camera::UpdateView() {
-    glBindBuffer(GL_UNIFORM_BUFFER, uboTransformMatrices);
-    glm::mat4 viewMatrix = glm::lookAt(position, position + glm::vec3(0., 0., -1.f), glm::vec3(0.f, 1.f, 0.f));
-    glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), sizeof(glm::mat4), glm::value_ptr(viewMatrix));
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+glm::mat4 Camera::GetViewMatrix() const {
+    return glm::lookAt(position, position + glm::vec3(0., 0., -1.f), glm::vec3(0.f, 1.f, 0.f));
 }
 
 void Camera::SetPosition(glm::vec3 newPosition) {
-    if (position != newPosition) {
-        position = newPosition;
-        UpdateView();
-    }
+    position = newPosition;
+}
+
+Bounds2D Camera::GetVisibleBounds() const {
+    glm::vec2 halfSize = glm::vec2(Resolution) / (2.f * scale);
+    glm::vec2 center(position.x, position.y);
+    return {center - halfSize, center + halfSize};
 }
 
 float Camera::GetScale() const {
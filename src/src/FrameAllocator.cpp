@@ -0,0 +1,57 @@
+#include "FrameAllocator.h"
+
+#include <algorithm>
+
+thread_local FrameAllocator* FrameAllocator::currentThreadAllocator = nullptr;
+
+FrameAllocator::FrameAllocator(size_t capacity)
+        : buffer(std::make_unique<std::byte[]>(capacity)), capacity(capacity), offset(0), overflowBytes(0),
+          overflowCount(0) {
+}
+
+void* FrameAllocator::Allocate(size_t size, size_t alignment) {
+    size_t alignedOffset = (offset + alignment - 1) & ~(alignment - 1);
+    if (alignedOffset + size <= capacity) {
+        offset = alignedOffset + size;
+        return buffer.get() + alignedOffset;
+    }
+
+    // Operator new[] of std::byte only guarantees the default new alignment, pad for anything stricter.
+    overflowBlocks.push_back(std::make_unique<std::byte[]>(size + alignment));
+    overflowBytes += size + alignment;
+    overflowCount++;
+
+    auto address = reinterpret_cast<uintptr_t>(overflowBlocks.back().get());
+    return reinterpret_cast<void*>((address + alignment - 1) & ~(uintptr_t(alignment) - 1));
+}
+
+void FrameAllocator::Reset() {
+    if (!overflowBlocks.empty()) {
+        capacity = std::max(capacity * 2, offset + overflowBytes);
+        buffer = std::make_unique<std::byte[]>(capacity);
+        overflowBlocks.clear();
+        overflowBytes = 0;
+    }
+
+    offset = 0;
+}
+
+size_t FrameAllocator::GetUsedBytes() const {
+    return offset + overflowBytes;
+}
+
+size_t FrameAllocator::GetCapacity() const {
+    return capacity;
+}
+
+uint32_t FrameAllocator::GetOverflowCount() const {
+    return overflowCount;
+}
+
+FrameAllocator* FrameAllocator::Get() {
+    return currentThreadAllocator;
+}
+
+void FrameAllocator::BindToCurrentThread(FrameAllocator* allocator) {
+    currentThreadAllocator = allocator;
+}
@@ -0,0 +1,133 @@
+#include "GlStateCache.h"
+
+#include <cstring>
+
+GlStateCache::GlStateCache()
+        : program(unknownName), vertexArray(unknownName), activeTextureUnit(unknownName), textures(),
+          storageBindings(), uniformValues(), callCounts() {
+    Reset();
+}
+
+void GlStateCache::Reset() {
+    program = unknownName;
+    vertexArray = unknownName;
+    activeTextureUnit = unknownName;
+    for (std::array<GLuint, 2>& unitTextures : textures)
+        unitTextures.fill(unknownName);
+    storageBindings.fill({unknownName, 0, 0});
+    isBlendEnabled.reset();
+    isDepthMaskEnabled.reset();
+}
+
+void GlStateCache::UseProgram(GLuint newProgram) {
+    if (program == newProgram) {
+        callCounts.redundant++;
+        return;
+    }
+
+    glUseProgram(newProgram);
+    program = newProgram;
+    callCounts.issued++;
+}
+
+void GlStateCache::BindVertexArray(GLuint newVertexArray) {
+    if (vertexArray == newVertexArray) {
+        callCounts.redundant++;
+        return;
+    }
+
+    glBindVertexArray(newVertexArray);
+    vertexArray = newVertexArray;
+    callCounts.issued++;
+}
+
+void GlStateCache::SetActiveTextureUnit(GLuint unit) {
+    if (activeTextureUnit == unit) {
+        callCounts.redundant++;
+        return;
+    }
+
+    glActiveTexture(GL_TEXTURE0 + unit);
+    activeTextureUnit = unit;
+    callCounts.issued++;
+}
+
+void GlStateCache::BindTexture(GLuint unit, GLenum target, GLuint texture) {
+    GLuint& boundTexture = textures[unit][target == GL_TEXTURE_2D_ARRAY ? 1 : 0];
+    if (boundTexture == texture) {
+        callCounts.redundant++;
+        return;
+    }
+
+    if (activeTextureUnit != unit) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        activeTextureUnit = unit;
+        callCounts.issued++;
+    }
+    glBindTexture(target, texture);
+    boundTexture = texture;
+    callCounts.issued++;
+}
+
+void GlStateCache::BindStorageBuffer(GLuint binding, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+    StorageBinding& boundBuffer = storageBindings[binding];
+    if (boundBuffer.buffer == buffer && boundBuffer.offset == offset && boundBuffer.size == size) {
+        callCounts.redundant++;
+        return;
+    }
+
+    if (size == 0)
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, buffer);
+    else
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER, binding, buffer, offset, size);
+    boundBuffer = {buffer, offset, size};
+    callCounts.issued++;
+}
+
+void GlStateCache::SetBlendEnabled(bool isEnabled) {
+    if (isBlendEnabled == isEnabled) {
+        callCounts.redundant++;
+        return;
+    }
+
+    if (isEnabled)
+        glEnable(GL_BLEND);
+    else
+        glDisable(GL_BLEND);
+    isBlendEnabled = isEnabled;
+    callCounts.issued++;
+}
+
+void GlStateCache::SetDepthMask(bool isEnabled) {
+    if (isDepthMaskEnabled == isEnabled) {
+        callCounts.redundant++;
+        return;
+    }
+
+    glDepthMask(isEnabled ? GL_TRUE : GL_FALSE);
+    isDepthMaskEnabled = isEnabled;
+    callCounts.issued++;
+}
+
+bool GlStateCache::IsUniformUnchanged(GLuint uniformProgram, GLint location, const void *value, size_t size) {
+    // Missing uniforms are left to GL, which ignores them.
+    if (location < 0 || size > sizeof(glm::mat4))
+        return false;
+
+    uint64_t key = (uint64_t(uniformProgram) << 32) | uint32_t(location);
+    auto [entry, isNew] = uniformValues.try_emplace(key);
+    if (!isNew && std::memcmp(entry->second.data(), value, size) == 0) {
+        callCounts.redundant++;
+        return true;
+    }
+
+    std::memcpy(entry->second.data(), value, size);
+    callCounts.issued++;
+    return false;
+}
+
+GlStateCallCounts GlStateCache::TakeCallCounts() {
+    GlStateCallCounts counts = callCounts;
+    callCounts = {};
+    return counts;
+}
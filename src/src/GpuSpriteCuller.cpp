@@ -0,0 +1,168 @@
+#include "GpuSpriteCuller.h"
+
+#include <algorithm>
+
+#include "ShaderWrapper.h"
+#include "SpriteInstance.h"
+#include "DrawElementsIndirectCommand.h"
+
+namespace {
+    // Must match the buffer bindings of the cull shaders.
+    constexpr GLuint commandBlockBinding = 0;
+    constexpr GLuint sourceCommandBlockBinding = 1;
+    constexpr GLuint localPrefixBlockBinding = 4;
+    constexpr GLuint groupOffsetBlockBinding = 5;
+    constexpr GLuint visibleSlotBlockBinding = 6;
+
+    GLuint DivideRoundingUp(GLuint value, GLuint divisor) {
+        return (value + divisor - 1) / divisor;
+    }
+
+    void AllocateBuffer(GLuint& buffer, GLsizeiptr size) {
+        glDeleteBuffers(1, &buffer);
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, size, nullptr, GL_DYNAMIC_COPY);
+    }
+}
+
+GpuSpriteCuller::GpuSpriteCuller()
+        : markShader(std::make_unique<ShaderWrapper>("res/shaders/cull_sprites.comp")),
+          scanShader(std::make_unique<ShaderWrapper>("res/shaders/cull_sprites_scan.comp")),
+          compactShader(std::make_unique<ShaderWrapper>("res/shaders/cull_sprites_compact.comp")),
+          visibleSlotBuffer(0), commandBuffer(0), localPrefixBuffer(0), groupOffsetBuffer(0), slotCapacity(0),
+          commandCapacity(0), groupCount(0), countBuffer(0), mappedCounts(nullptr), countFences(), nextCountSlot(0),
+          latestVisibleCount(0) {
+    Reserve(1024, 256);
+
+    glGenBuffers(1, &countBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, countBuffer);
+    GLsizeiptr countBufferSize = countSlotCount * sizeof(GLuint);
+    if (GLAD_GL_VERSION_4_4) {
+        GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_WRITE_BUFFER, countBufferSize, nullptr, flags);
+        mappedCounts = static_cast<const GLuint*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, countBufferSize, flags));
+    } else {
+        glBufferData(GL_COPY_WRITE_BUFFER, countBufferSize, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+GpuSpriteCuller::~GpuSpriteCuller() {
+    glDeleteBuffers(1, &visibleSlotBuffer);
+    glDeleteBuffers(1, &commandBuffer);
+    glDeleteBuffers(1, &localPrefixBuffer);
+    glDeleteBuffers(1, &groupOffsetBuffer);
+    glDeleteBuffers(1, &countBuffer);
+    for (GLsync fence : countFences)
+        glDeleteSync(fence);
+}
+
+void GpuSpriteCuller::Cull(GLuint instanceBuffer, GLintptr instanceOffset, uint32_t instanceCount,
+                           GLuint sourceCommandBuffer, GLintptr sourceCommandOffset, uint32_t commandCount) {
+    CollectVisibleCounts();
+
+    Reserve(instanceCount, commandCount);
+    groupCount = std::max(DivideRoundingUp(instanceCount, groupSize), 1u);
+
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, instanceBlockBinding, instanceBuffer, instanceOffset,
+                      std::max<GLsizeiptr>(instanceCount * sizeof(SpriteInstance), sizeof(SpriteInstance)));
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, sourceCommandBlockBinding, sourceCommandBuffer, sourceCommandOffset,
+                      commandCount * sizeof(DrawElementsIndirectCommand));
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, commandBlockBinding, commandBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, localPrefixBlockBinding, localPrefixBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, groupOffsetBlockBinding, groupOffsetBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, visibleSlotBlockBinding, visibleSlotBuffer);
+
+    // Tests every instance and counts the visible ones before it within its workgroup.
+    markShader->Activate();
+    markShader->SetUInt("instanceCount", instanceCount);
+    glDispatchCompute(groupCount, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // Turns the workgroup totals into offsets, the last entry is the visible count.
+    scanShader->Activate();
+    scanShader->SetUInt("groupCount", groupCount);
+    glDispatchCompute(1, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // Scatters the visible slots and rewrites the commands, one invocation per slot or command.
+    compactShader->Activate();
+    compactShader->SetUInt("instanceCount", instanceCount);
+    compactShader->SetUInt("commandCount", commandCount);
+    glDispatchCompute(DivideRoundingUp(std::max(groupCount * groupSize, commandCount), groupSize), 1, 1);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT
+                    | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    // A slot the GPU is still behind on is reused without being read, the newer count replaces it anyway.
+    GLsync& fence = countFences[nextCountSlot];
+    glDeleteSync(fence);
+    glBindBuffer(GL_COPY_READ_BUFFER, groupOffsetBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, countBuffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, groupCount * sizeof(GLuint),
+                        nextCountSlot * sizeof(GLuint), sizeof(GLuint));
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    nextCountSlot = (nextCountSlot + 1) % countSlotCount;
+}
+
+void GpuSpriteCuller::CollectVisibleCounts() {
+    for (uint32_t i = 0; i < countSlotCount; i++) {
+        uint32_t slot = (nextCountSlot + i) % countSlotCount;
+        GLsync& fence = countFences[slot];
+        if (fence == nullptr)
+            continue;
+
+        GLenum status = glClientWaitSync(fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            continue;
+
+        glDeleteSync(fence);
+        fence = nullptr;
+        if (mappedCounts != nullptr) {
+            latestVisibleCount = mappedCounts[slot];
+        } else {
+            glBindBuffer(GL_COPY_READ_BUFFER, countBuffer);
+            glGetBufferSubData(GL_COPY_READ_BUFFER, slot * sizeof(GLuint), sizeof(GLuint), &latestVisibleCount);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        }
+    }
+}
+
+uint32_t GpuSpriteCuller::ReadVisibleCount() const {
+    GLuint visibleCount = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, groupOffsetBuffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, groupCount * sizeof(GLuint), sizeof(GLuint), &visibleCount);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    return visibleCount;
+}
+
+uint32_t GpuSpriteCuller::GetLatestVisibleCount() const {
+    return latestVisibleCount;
+}
+
+GLuint GpuSpriteCuller::GetVisibleSlotBuffer() const {
+    return visibleSlotBuffer;
+}
+
+GLuint GpuSpriteCuller::GetCommandBuffer() const {
+    return commandBuffer;
+}
+
+void GpuSpriteCuller::Reserve(uint32_t slotCount, uint32_t commandCount) {
+    if (slotCount > slotCapacity) {
+        slotCapacity = std::max(slotCount, slotCapacity * 2);
+        // The prefixes cover whole workgroups, the offsets one entry past the last workgroup.
+        GLuint capacityGroupCount = DivideRoundingUp(slotCapacity, groupSize);
+        AllocateBuffer(visibleSlotBuffer, slotCapacity * sizeof(GLuint));
+        AllocateBuffer(localPrefixBuffer, capacityGroupCount * groupSize * sizeof(GLuint));
+        AllocateBuffer(groupOffsetBuffer, (capacityGroupCount + 1) * sizeof(GLuint));
+    }
+
+    if (commandCount > commandCapacity) {
+        commandCapacity = std::max(commandCount, commandCapacity * 2);
+        AllocateBuffer(commandBuffer, commandCapacity * sizeof(DrawElementsIndirectCommand));
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
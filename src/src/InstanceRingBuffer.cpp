@@ -0,0 +1,190 @@
+#include "InstanceRingBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "LoggingMacros.h"
+
+InstanceRingBuffer::InstanceRingBuffer(GLsizeiptr initialRegionSize)
+        : bufferId(0), regionSize(0), mappedMemory(nullptr), fences(), currentRegion(0), isRegionStale() {
+    isPersistent = GLAD_GL_VERSION_4_4 != 0;
+    if (!isPersistent)
+        SPDLOG_DEBUG("GL 4.4 is not available, instance data falls back to glBufferData uploads");
+
+    Allocate(initialRegionSize);
+}
+
+InstanceRingBuffer::~InstanceRingBuffer() {
+    Release();
+}
+
+void* InstanceRingBuffer::BeginWrite(GLsizeiptr size) {
+    if (size > regionSize)
+        Allocate(std::max(size, regionSize * 2));
+
+    if (!isPersistent)
+        return stagingMemory.data();
+
+    currentRegion = (currentRegion + 1) % regionCount;
+    WaitForRegion(currentRegion);
+
+    for (uint32_t region = 0; region < regionCount; region++)
+        isRegionStale[region] = region != currentRegion;
+    pendingRanges[currentRegion].clear();
+
+    return mappedMemory + currentRegion * regionSize;
+}
+
+void InstanceRingBuffer::EndWrite(GLsizeiptr size) {
+    if (isPersistent)
+        return;
+
+    glBindBuffer(GL_ARRAY_BUFFER, bufferId);
+    glBufferData(GL_ARRAY_BUFFER, regionSize, nullptr, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, size, stagingMemory.data());
+}
+
+GLsizeiptr InstanceRingBuffer::WriteRanges(const void* source, GLsizeiptr size, std::span<const InstanceRange> dirtyRanges) {
+    if (dirtyRanges.empty())
+        return 0;
+
+    if (size > regionSize)
+        Allocate(std::max(size, regionSize * 2));
+
+    const auto* sourceBytes = static_cast<const std::byte*>(source);
+
+    if (!isPersistent) {
+        glBindBuffer(GL_ARRAY_BUFFER, bufferId);
+        if (isRegionStale[0]) {
+            glBufferSubData(GL_ARRAY_BUFFER, 0, size, sourceBytes);
+            isRegionStale[0] = false;
+            return size;
+        }
+
+        GLsizeiptr uploadedBytes = 0;
+        for (const InstanceRange& range : dirtyRanges) {
+            glBufferSubData(GL_ARRAY_BUFFER, range.offset, range.size, sourceBytes + range.offset);
+            uploadedBytes += range.size;
+        }
+        return uploadedBytes;
+    }
+
+    for (auto& ranges : pendingRanges)
+        ranges.insert(ranges.end(), dirtyRanges.begin(), dirtyRanges.end());
+
+    currentRegion = (currentRegion + 1) % regionCount;
+    WaitForRegion(currentRegion);
+
+    std::byte* region = mappedMemory + currentRegion * regionSize;
+    std::vector<InstanceRange>& ranges = pendingRanges[currentRegion];
+    GLsizeiptr uploadedBytes = 0;
+
+    if (isRegionStale[currentRegion]) {
+        std::memcpy(region, sourceBytes, size);
+        uploadedBytes = size;
+        isRegionStale[currentRegion] = false;
+    } else {
+        std::sort(ranges.begin(), ranges.end(), [](const InstanceRange& A, const InstanceRange& B) {
+            return A.offset < B.offset;
+        });
+
+        GLintptr writtenEnd = 0;
+        for (const InstanceRange& range : ranges) {
+            GLintptr begin = std::max(range.offset, writtenEnd);
+            GLintptr end = std::min<GLintptr>(range.offset + range.size, size);
+            if (begin >= end)
+                continue;
+
+            std::memcpy(region + begin, sourceBytes + begin, end - begin);
+            uploadedBytes += end - begin;
+            writtenEnd = end;
+        }
+    }
+
+    ranges.clear();
+    return uploadedBytes;
+}
+
+void InstanceRingBuffer::FenceCurrentRegion() {
+    if (!isPersistent)
+        return;
+
+    if (fences[currentRegion] != nullptr)
+        glDeleteSync(fences[currentRegion]);
+
+    fences[currentRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+GLuint InstanceRingBuffer::GetBufferId() const {
+    return bufferId;
+}
+
+GLintptr InstanceRingBuffer::GetCurrentRegionOffset() const {
+    return isPersistent ? currentRegion * regionSize : 0;
+}
+
+bool InstanceRingBuffer::IsPersistent() const {
+    return isPersistent;
+}
+
+void InstanceRingBuffer::Allocate(GLsizeiptr newRegionSize) {
+    // Keeps every region offset suitably aligned for any vertex attribute type.
+    newRegionSize = (newRegionSize + 255) & ~GLsizeiptr(255);
+
+    Release();
+    regionSize = newRegionSize;
+
+    for (uint32_t region = 0; region < regionCount; region++) {
+        pendingRanges[region].clear();
+        isRegionStale[region] = true;
+    }
+
+    glGenBuffers(1, &bufferId);
+    glBindBuffer(GL_ARRAY_BUFFER, bufferId);
+
+    if (isPersistent) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, regionSize * regionCount, nullptr, flags);
+        mappedMemory = static_cast<std::byte*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, regionSize * regionCount, flags));
+    } else {
+        glBufferData(GL_ARRAY_BUFFER, regionSize, nullptr, GL_DYNAMIC_DRAW);
+        stagingMemory.resize(regionSize);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceRingBuffer::Release() {
+    if (bufferId == 0)
+        return;
+
+    for (uint32_t region = 0; region < regionCount; region++)
+        WaitForRegion(region);
+
+    if (mappedMemory != nullptr) {
+        glBindBuffer(GL_ARRAY_BUFFER, bufferId);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        mappedMemory = nullptr;
+    }
+
+    glDeleteBuffers(1, &bufferId);
+    bufferId = 0;
+}
+
+void InstanceRingBuffer::WaitForRegion(uint32_t region) {
+    GLsync fence = fences[region];
+    if (fence == nullptr)
+        return;
+
+    GLenum waitResult = glClientWaitSync(fence, 0, 0);
+    // Only a timeout is waited out again. GL_WAIT_FAILED, or anything else a call without a current context returns,
+    // would never turn into a signal.
+    while (waitResult == GL_TIMEOUT_EXPIRED)
+        waitResult = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+    if (waitResult != GL_ALREADY_SIGNALED && waitResult != GL_CONDITION_SATISFIED)
+        SPDLOG_ERROR("Waiting for instance buffer region failed");
+
+    glDeleteSync(fence);
+    fences[region] = nullptr;
+}
@@ -0,0 +1,224 @@
+#include "JobSystem.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "LoggingMacros.h"
+
+thread_local uint32_t JobSystem::threadIndex = 0;
+thread_local const JobSystem* JobSystem::threadOwner = nullptr;
+
+JobSystem::WorkerQueue::WorkerQueue() : jobs(initialQueueCapacity) {
+}
+
+void JobSystem::WorkerQueue::PushBack(const Job& job) {
+    if (count == jobs.size()) {
+        std::vector<Job> grownJobs(jobs.size() * 2);
+        for (size_t i = 0; i < count; i++)
+            grownJobs[i] = jobs[(head + i) % jobs.size()];
+        jobs.swap(grownJobs);
+        head = 0;
+    }
+
+    jobs[(head + count) % jobs.size()] = job;
+    count++;
+}
+
+bool JobSystem::WorkerQueue::PopBack(Job& job) {
+    if (count == 0)
+        return false;
+
+    count--;
+    job = jobs[(head + count) % jobs.size()];
+    return true;
+}
+
+bool JobSystem::WorkerQueue::PopFront(Job& job) {
+    if (count == 0)
+        return false;
+
+    job = jobs[head];
+    head = (head + 1) % jobs.size();
+    count--;
+    return true;
+}
+
+JobCounter::JobCounter() : value(0) {
+}
+
+bool JobCounter::IsDone() const {
+    if (value.load(std::memory_order_acquire) != 0)
+        return false;
+
+    // The last job may still be releasing the waiting jobs, the counter must outlive that.
+    std::lock_guard<std::mutex> lock(waitingMutex);
+    return value.load(std::memory_order_relaxed) == 0;
+}
+
+JobSystem::JobSystem(uint32_t workerCount, bool pinThreads, std::function<void(uint32_t)> onWorkerStart)
+        : isRunning(true), pendingJobs(0) {
+    for (uint32_t i = 0; i < workerCount + 1; i++)
+        queues.push_back(std::make_unique<WorkerQueue>());
+
+    for (uint32_t i = 0; i < workerCount; i++)
+        workers.emplace_back(&JobSystem::WorkerLoop, this, i + 1, pinThreads, onWorkerStart);
+
+    SPDLOG_DEBUG("Job system started with {} workers", workerCount);
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        isRunning = false;
+    }
+    sleepCondition.notify_all();
+
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+void JobSystem::Dispatch(const Job& job) {
+    if (job.counter != nullptr)
+        job.counter->value.fetch_add(1, std::memory_order_relaxed);
+
+    if (job.dependency != nullptr) {
+        std::lock_guard<std::mutex> lock(job.dependency->waitingMutex);
+        if (job.dependency->value.load(std::memory_order_acquire) != 0) {
+            job.dependency->waitingJobs.push_back(job);
+            return;
+        }
+    }
+
+    Enqueue(job);
+}
+
+void JobSystem::Enqueue(const Job& job) {
+    WorkerQueue& queue = *queues[GetQueueIndex()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.PushBack(job);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        pendingJobs.fetch_add(1, std::memory_order_release);
+    }
+    sleepCondition.notify_one();
+}
+
+void JobSystem::Wait(const JobCounter& counter) {
+    while (!counter.IsDone()) {
+        if (TryRunJob(GetQueueIndex()))
+            continue;
+
+        // Nothing to help with, sleep until a job is queued or a counter reaches zero.
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepCondition.wait(lock, [this, &counter] {
+            return pendingJobs.load(std::memory_order_acquire) > 0 || counter.IsDone();
+        });
+    }
+}
+
+uint32_t JobSystem::GetWorkerCount() const {
+    return static_cast<uint32_t>(workers.size());
+}
+
+uint32_t JobSystem::GetThreadIndex() {
+    return threadIndex;
+}
+
+uint32_t JobSystem::GetQueueIndex() const {
+    return threadOwner == this ? threadIndex : 0;
+}
+
+void JobSystem::WorkerLoop(uint32_t index, bool pinThread, std::function<void(uint32_t)> onWorkerStart) {
+    threadIndex = index;
+    threadOwner = this;
+
+    if (pinThread)
+        PinCurrentThread(index % std::max(std::thread::hardware_concurrency(), 1u));
+
+    if (onWorkerStart)
+        onWorkerStart(index);
+
+    while (true) {
+        if (TryRunJob(index))
+            continue;
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepCondition.wait(lock, [this] {
+            return !isRunning || pendingJobs.load(std::memory_order_acquire) > 0;
+        });
+
+        if (!isRunning)
+            return;
+    }
+}
+
+bool JobSystem::TryRunJob(uint32_t index) {
+    // Queues only hold jobs whose dependency is done, the others wait on their dependency's counter.
+    Job job;
+    if (!PopJob(index, job))
+        return false;
+
+    job.function(job.data, job.begin, job.end);
+    FinishJob(job);
+    return true;
+}
+
+void JobSystem::FinishJob(const Job& job) {
+    if (job.counter == nullptr)
+        return;
+
+    std::vector<Job> readyJobs;
+    {
+        std::lock_guard<std::mutex> lock(job.counter->waitingMutex);
+        if (job.counter->value.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            return;
+        readyJobs.swap(job.counter->waitingJobs);
+    }
+
+    // The counter may be gone from here on, its waiter can return as soon as the lock is released.
+    for (const Job& readyJob : readyJobs)
+        Enqueue(readyJob);
+
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    sleepCondition.notify_all();
+}
+
+bool JobSystem::PopJob(uint32_t index, Job& job) {
+    // The owner takes its newest job, thieves take the oldest one from the other end.
+    {
+        WorkerQueue& queue = *queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.PopBack(job)) {
+            pendingJobs.fetch_sub(1, std::memory_order_acq_rel);
+            return true;
+        }
+    }
+
+    for (size_t offset = 1; offset < queues.size(); offset++) {
+        WorkerQueue& victim = *queues[(index + offset) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.PopFront(job)) {
+            pendingJobs.fetch_sub(1, std::memory_order_acq_rel);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void JobSystem::PinCurrentThread(uint32_t core) {
+#ifdef __linux__
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(core, &cpuSet);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuSet) != 0)
+        SPDLOG_ERROR("Failed to pin job worker to core {}", core);
+#else
+    (void)core;
+#endif
+}
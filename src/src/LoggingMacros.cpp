@@ -5,6 +5,6 @@ void LoggingMacros::InitializeSPDLog()
 #ifdef DEBUG
     spdlog::set_level(spdlog::level::debug);
 #else
-    spdlog::set_level(spdlog::level::err);
+    spdlog::set_level(spdlog::level::info);
 #endif
 }
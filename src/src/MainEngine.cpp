@@ -1,5 +1,9 @@
 #include "MainEngine.h"
 
+#include <array>
+#include <cmath>
+#include <random>
+
 #include <glad/glad.h>
 
 #include <imgui.h>
@@ -9,9 +13,12 @@
 #include <stb_image.h>
 
 #include "LoggingMacros.h"
+#include "JobSystem.h"
+#include "FrameAllocator.h"
 #include "SpriteRenderer.h"
 #include "ShaderWrapper.h"
 #include "Sprite.h"
+#include "RenderThread.h"
 
 #include "Nodes/CollisionShapes/CollisionShapeFactory.h"
 #include "Nodes/RigidbodyNode.h"
@@ -22,7 +29,7 @@
 #include "Nodes/TimerNode.h"
 #include "Nodes/ParallaxNode.h"
 
-int32_t MainEngine::Init() {
+int32_t MainEngine::Init(bool isOffscreen) {
     glfwSetErrorCallback(MainEngine::GLFWErrorCallback);
     if (!glfwInit())
         return 1;
@@ -33,6 +40,7 @@ int32_t MainEngine::Init() {
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);  // 3.2+ only
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);            // 3.0+ only
 
+    glfwWindowHint(GLFW_VISIBLE, isOffscreen ? GLFW_FALSE : GLFW_TRUE);
     if (InitializeWindow() != 0)
         return 1;
 
@@ -52,7 +60,18 @@ int32_t MainEngine::Init() {
 
     glClearColor(0.929f, 0.706f, 0.631f, 1.f);
 
+    uint32_t workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+    for (uint32_t i = 0; i < workerCount + 1; i++)
+        frameAllocators.push_back(std::make_unique<FrameAllocator>(1 << 20));
+    FrameAllocator::BindToCurrentThread(frameAllocators[0].get());
+
+    jobSystem = std::make_unique<JobSystem>(workerCount, false, [this](uint32_t threadIndex) {
+        FrameAllocator::BindToCurrentThread(frameAllocators[threadIndex].get());
+    });
+
     renderer = std::make_unique<SpriteRenderer>("res/textures/TileMap.png", 8);
+    renderer->SetJobSystem(jobSystem.get());
 
     return 0;
 }
@@ -84,6 +103,11 @@ int32_t MainEngine::MainLoop() {
     CheckGLErrors();
 #endif
 
+    // Creates the ImGui font texture while this thread still has the context, later frames make no GL calls here.
+    ImGui_ImplOpenGL3_NewFrame();
+    glfwMakeContextCurrent(nullptr);
+    renderThread = std::make_unique<RenderThread>(window, *renderer);
+
     while (!glfwWindowShouldClose(window)) {
         // TimeCalculation
         std::chrono::duration<float> timeFromStart = std::chrono::high_resolution_clock::now() - startProgramTimePoint;
@@ -91,36 +115,244 @@ int32_t MainEngine::MainLoop() {
         float deltaSeconds = seconds - previousFrameSeconds;
         previousFrameSeconds = seconds;
 
-        glClearDepth(1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
         // Start the Dear ImGui frame
-        ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
-        glm::vec<2, int> currentResolution{};
-        glfwMakeContextCurrent(window);
-        glfwGetFramebufferSize(window, &currentResolution.x, &currentResolution.y);
-        glViewport(0, 0, currentResolution.x, currentResolution.y);
+        UpdateScene(seconds, deltaSeconds);
+
+        UpdateWidget(deltaSeconds);
+        ImGui::Render();
+
+        // The render thread submits the previous frame until here.
+        RenderSnapshot& snapshot = renderThread->BeginFrame();
+        glfwGetFramebufferSize(window, &snapshot.framebufferSize.x, &snapshot.framebufferSize.y);
+        renderer->Prepare(snapshot.sprites);
+        snapshot.SetUiDrawData(*ImGui::GetDrawData());
+        renderThread->EndFrame();
+
+        glfwPollEvents();
+    }
+
+    renderThread.reset();
+    glfwMakeContextCurrent(window);
+    return 0;
+}
+
+void MainEngine::UpdateScene(float seconds, float deltaSeconds) {
+    for (auto& frameAllocator : frameAllocators)
+        frameAllocator->Reset();
+
+    updateScheduler.Run(this, seconds, deltaSeconds);
+    sceneEditQueue.Apply(this);
+    sceneRoot.CalculateWorldTransform();
+    sceneRoot.Draw();
+
+    if (currentCameraNode == nullptr) {
+        SPDLOG_ERROR("No active CameraNode");
+        return;
+    }
+
+    renderer->SetViewBounds(currentCameraNode->GetVisibleBounds());
+    renderer->SetCameraMatrices(currentCameraNode->GetProjectionMatrix(), currentCameraNode->GetViewMatrix());
+}
 
-        sceneRoot.Update(this, seconds, deltaSeconds);
-        sceneRoot.CalculateWorldTransform();
-        sceneRoot.Draw();
+void MainEngine::UpdateAndDrawScene(float seconds, float deltaSeconds) {
+    UpdateScene(seconds, deltaSeconds);
 
+    glm::vec<2, int> currentResolution{};
+    glfwGetFramebufferSize(window, &currentResolution.x, &currentResolution.y);
+    glViewport(0, 0, currentResolution.x, currentResolution.y);
+    glClearDepth(1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    renderer->Draw();
+}
+
+int32_t MainEngine::MeasureOverdraw(uint32_t frameCount) {
+    // Enough frames for static sprites to be baked and the opaque pass sort keys to settle.
+    constexpr uint32_t warmUpFrameCount = 90;
+    constexpr float frameSeconds = 1.f / 60.f;
+
+    sceneRoot.Start(this);
+    renderer->SetFragmentCountingEnabled(true);
+
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    float pixelCount = static_cast<float>(std::max(width * height, 1));
+
+    float seconds = 0.f;
+    for (bool isOpaquePassEnabled : {false, true}) {
+        renderer->SetOpaquePassEnabled(isOpaquePassEnabled);
+
+        uint64_t fragmentSum = 0;
+        for (uint32_t frame = 0; frame < warmUpFrameCount + frameCount; frame++) {
+            seconds += frameSeconds;
+            UpdateAndDrawScene(seconds, frameSeconds);
+            // Makes the query of this frame available to the next Draw().
+            glFinish();
+
+            if (frame > warmUpFrameCount)
+                fragmentSum += renderer->GetStatistics().fragmentCount;
+        }
+
+        float fragmentsPerFrame = static_cast<float>(fragmentSum) / static_cast<float>(std::max(frameCount - 1, 1u));
+        SPDLOG_INFO("{}: {:.0f} fragments per frame, {:.2f} per pixel",
+                    isOpaquePassEnabled ? "opaque pass" : "blended only", fragmentsPerFrame,
+                    fragmentsPerFrame / pixelCount);
+    }
+
+    return 0;
+}
+
+int32_t MainEngine::VerifyGpuCulling(uint32_t frameCount) {
+    constexpr float frameSeconds = 1.f / 60.f;
+    // Zoomed in far enough that most of the map is culled, and out until little is.
+    constexpr std::array<float, 4> cameraScales = {96.f, 48.f, 24.f, 8.f};
+
+    sceneRoot.Start(this);
+    renderer->SetCullingEnabled(true);
+
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    std::vector<unsigned char> cpuPixels(static_cast<size_t>(width) * height * 4);
+    std::vector<unsigned char> gpuPixels(cpuPixels.size());
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+    uint32_t mismatchedFrameCount = 0;
+    float seconds = 0.f;
+    for (uint32_t frame = 0; frame < frameCount; frame++) {
+        currentCameraNode->SetScale(cameraScales[frame % cameraScales.size()]);
+        seconds += frameSeconds;
+
+        renderer->SetGpuCullingEnabled(false);
+        UpdateAndDrawScene(seconds, frameSeconds);
+        uint32_t cpuVisibleCount = renderer->GetStatistics().visibleInstanceCount;
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, cpuPixels.data());
+
+        // The same scene state again, only the renderer runs.
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        renderer->SetGpuCullingEnabled(true);
         renderer->Draw();
+        uint32_t gpuVisibleCount = renderer->ReadGpuVisibleInstanceCount();
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, gpuPixels.data());
+
+        if (cpuPixels != gpuPixels) {
+            mismatchedFrameCount++;
+            SPDLOG_INFO("frame {}: images differ, {} sprites visible on the CPU, {} on the GPU", frame,
+                        cpuVisibleCount, gpuVisibleCount);
+        }
+    }
+
+    SPDLOG_INFO("{} frames compared, {} differ", frameCount, mismatchedFrameCount);
+    return mismatchedFrameCount == 0 ? 0 : 1;
+}
 
-        if (currentCameraNode == nullptr)
-            SPDLOG_ERROR("No active CameraNode");
+int32_t MainEngine::MeasureRenderThread(uint32_t frameCount) {
+    // Every sprite frame is submitted this many times, so submitting costs more than simulating.
+    constexpr uint32_t submitCount = 16;
+    constexpr float frameSeconds = 1.f / 60.f;
+    using Milliseconds = std::chrono::duration<float, std::milli>;
 
-        UpdateWidget(deltaSeconds);
-        ImGui::Render();
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    sceneRoot.Start(this);
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+    glm::ivec2 framebufferSize;
+    glfwGetFramebufferSize(window, &framebufferSize.x, &framebufferSize.y);
+
+    float seconds = 0.f;
+    RenderSnapshot serialSnapshot;
+    serialSnapshot.framebufferSize = framebufferSize;
+    auto startTimePoint = std::chrono::high_resolution_clock::now();
+    for (uint32_t frame = 0; frame < frameCount; frame++) {
+        seconds += frameSeconds;
+        UpdateScene(seconds, frameSeconds);
+        renderer->Prepare(serialSnapshot.sprites);
+        RenderThread::DrawSnapshot(window, *renderer, serialSnapshot, submitCount);
+    }
+    glFinish();
+    float serialMilliseconds = Milliseconds(std::chrono::high_resolution_clock::now() - startTimePoint).count();
+
+    glfwMakeContextCurrent(nullptr);
+    renderThread = std::make_unique<RenderThread>(window, *renderer, submitCount);
+    startTimePoint = std::chrono::high_resolution_clock::now();
+    for (uint32_t frame = 0; frame < frameCount; frame++) {
+        seconds += frameSeconds;
+        UpdateScene(seconds, frameSeconds);
+
+        RenderSnapshot& snapshot = renderThread->BeginFrame();
+        snapshot.framebufferSize = framebufferSize;
+        renderer->Prepare(snapshot.sprites);
+        renderThread->EndFrame();
     }
+    // Waits for the last snapshot.
+    renderThread.reset();
+    glfwMakeContextCurrent(window);
+    glFinish();
+    float threadedMilliseconds = Milliseconds(std::chrono::high_resolution_clock::now() - startTimePoint).count();
 
+    float frames = static_cast<float>(std::max(frameCount, 1u));
+    SPDLOG_INFO("{} submits per frame: {:.3f} ms per frame serial, {:.3f} ms with the render thread", submitCount,
+                serialMilliseconds / frames, threadedMilliseconds / frames);
+    return 0;
+}
+
+int32_t MainEngine::MeasureInstanceBuilding(uint32_t spriteCount, uint32_t frameCount) {
+    constexpr std::array<uint32_t, 4> coreCounts = {1, 2, 4, 8};
+    uint32_t hardwareThreadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    constexpr float frameSeconds = 1.f / 60.f;
+
+    // A field of sprites that all move every frame, so every instance is written again.
+    auto sprite = std::make_shared<Sprite>(glm::ivec2(3, 1));
+    auto field = std::make_shared<Node>();
+    std::vector<SpriteNode*> fieldNodes;
+    std::vector<glm::vec3> fieldPositions;
+    std::mt19937 generator(1234);
+    std::uniform_real_distribution<float> positionDistribution(-256.f, 256.f);
+    for (uint32_t i = 0; i < spriteCount; i++) {
+        auto node = std::make_shared<SpriteNode>(sprite, renderer.get());
+        glm::vec3 position(positionDistribution(generator), positionDistribution(generator), 1.f);
+        node->MutableLocalTransform()->SetPosition(position);
+        fieldNodes.push_back(node.get());
+        fieldPositions.push_back(position);
+        field->AddChild(node);
+    }
+    sceneRoot.AddChild(field);
+    sceneRoot.Start(this);
+
+    // The measured workers get the scratch of the engine's workers with the same index, those sit idle meanwhile.
+    while (frameAllocators.size() < coreCounts.back())
+        frameAllocators.push_back(std::make_unique<FrameAllocator>(1 << 20));
+
+    float seconds = 0.f;
+    for (uint32_t coreCount : coreCounts) {
+        JobSystem measuredJobSystem(coreCount - 1, false, [this](uint32_t threadIndex) {
+            FrameAllocator::BindToCurrentThread(frameAllocators[threadIndex].get());
+        });
+        renderer->SetJobSystem(&measuredJobSystem);
+
+        float buildMilliseconds = 0.f;
+        float prepareMilliseconds = 0.f;
+        for (uint32_t frame = 0; frame < frameCount; frame++) {
+            seconds += frameSeconds;
+            for (uint32_t i = 0; i < spriteCount; i++) {
+                glm::vec3 offset(std::sin(seconds + static_cast<float>(i)), std::cos(seconds), 0.f);
+                fieldNodes[i]->MutableLocalTransform()->SetPosition(fieldPositions[i] + offset);
+            }
+            UpdateAndDrawScene(seconds, frameSeconds);
+
+            SpriteRendererStatistics rendererStatistics = renderer->GetStatistics();
+            buildMilliseconds += rendererStatistics.instanceBuildMilliseconds;
+            prepareMilliseconds += rendererStatistics.prepareMilliseconds;
+        }
+
+        float frames = static_cast<float>(std::max(frameCount, 1u));
+        // More cores than the machine has only measure the cost of the extra threads.
+        SPDLOG_INFO("{} cores{}: instances {:.3f} ms, prepare {:.3f} ms per frame", coreCount,
+                    coreCount > hardwareThreadCount ? " (oversubscribed)" : "", buildMilliseconds / frames,
+                    prepareMilliseconds / frames);
+    }
+
+    renderer->SetJobSystem(jobSystem.get());
     return 0;
 }
 
@@ -128,6 +360,49 @@ void MainEngine::UpdateWidget(float DeltaSeconds) {
     ImGui::Begin("Yet another 2D Engine");
     ImGui::Text("Framerate: %.3f (%.1f FPS)", DeltaSeconds, 1 / DeltaSeconds);
 
+    SpriteRendererStatistics rendererStatistics = renderer->GetStatistics();
+    ImGui::Text("Sprites drawn: %u / %u in %u runs, prepare: %.3f ms (instances %.3f ms), submit: %.3f ms",
+                rendererStatistics.visibleInstanceCount, rendererStatistics.instanceCount,
+                rendererStatistics.drawRunCount, rendererStatistics.prepareMilliseconds,
+                rendererStatistics.instanceBuildMilliseconds, rendererStatistics.submitMilliseconds);
+    if (renderThread != nullptr) {
+        RenderThreadStatistics renderThreadStatistics = renderThread->GetStatistics();
+        ImGui::Text("Render thread: %.3f ms per frame, waited %.3f ms", renderThreadStatistics.drawMilliseconds,
+                    renderThreadStatistics.waitMilliseconds);
+    }
+
+    ImGui::Text("Material binds: %u, GL state calls: %u (%u redundant skipped)", rendererStatistics.materialBindCount,
+                rendererStatistics.stateCallCount, rendererStatistics.redundantStateCallCount);
+
+    ImGui::Text("Tile layers drawn: %u, mesh quads: %u", rendererStatistics.tileLayerCount,
+                rendererStatistics.tileMeshQuadCount);
+    ImGui::Text("Static sprites: %u in %u chunks", rendererStatistics.staticInstanceCount,
+                rendererStatistics.staticChunkCount);
+
+    bool isOpaquePassEnabled = renderer->IsOpaquePassEnabled();
+    if (ImGui::Checkbox("Opaque pass", &isOpaquePassEnabled))
+        renderer->SetOpaquePassEnabled(isOpaquePassEnabled);
+    constinit static bool isCountingFragments = false;
+    if (ImGui::Checkbox("Count fragments", &isCountingFragments))
+        renderer->SetFragmentCountingEnabled(isCountingFragments);
+    if (isCountingFragments)
+        ImGui::Text("Fragments written: %u", rendererStatistics.fragmentCount);
+
+    bool isCullingEnabled = renderer->IsCullingEnabled();
+    if (ImGui::Checkbox("Cull sprites", &isCullingEnabled))
+        renderer->SetCullingEnabled(isCullingEnabled);
+    bool isGpuCullingEnabled = renderer->IsGpuCullingEnabled();
+    if (ImGui::Checkbox("Cull on the GPU", &isGpuCullingEnabled))
+        renderer->SetGpuCullingEnabled(isGpuCullingEnabled);
+    ImGui::Text("Instance upload: %u bytes (%u per instance), resorted keys: %u", rendererStatistics.uploadedBytes,
+                rendererStatistics.bytesPerInstance, rendererStatistics.resortedKeys);
+
+    constinit static SpriteSortTimings sortTimings;
+    if (ImGui::Button("Benchmark sprite sort (100k)"))
+        sortTimings = SpriteRenderer::MeasureSortTimes(100000);
+    ImGui::Text("comparator %.2f ms, radix %.2f ms, insertion (16 moved) %.2f ms",
+                sortTimings.comparatorMilliseconds, sortTimings.radixMilliseconds, sortTimings.insertionMilliseconds);
+
     float cameraScale = currentCameraNode->GetScale();
     ImGui::DragFloat("Camera Scale", &cameraScale, 0.5f, 1.f, 256.f);
     currentCameraNode->SetScale(cameraScale);
@@ -190,11 +465,35 @@ void MainEngine::UpdateWidget(float DeltaSeconds) {
     player->SetButtonPressJumpGravityFactor(buttonPressGravityFactor);
     player->SetJumpParameters(jumpHeight, jumpDistance);
 
+    ImGui::Separator();
+
+    constinit static float jobDispatchOverhead = 0.f;
+
+    ImGui::Text("Job workers: %u", jobSystem->GetWorkerCount());
+    if (ImGui::Button("Measure job dispatch"))
+        jobDispatchOverhead = MeasureJobDispatchOverhead();
+    ImGui::SameLine();
+    ImGui::Text("%.1f ns/job", jobDispatchOverhead);
+
+    const FrameAllocator* frameAllocator = FrameAllocator::Get();
+    ImGui::Text("Frame scratch: %zu / %zu KB, %u overflows", frameAllocator->GetUsedBytes() / 1024,
+                frameAllocator->GetCapacity() / 1024, frameAllocator->GetOverflowCount());
+
     ImGui::End();
 }
 
+float MainEngine::MeasureJobDispatchOverhead() {
+    constexpr uint32_t jobCount = 100000;
+
+    auto startTimePoint = std::chrono::high_resolution_clock::now();
+    jobSystem->ParallelFor(jobCount, 1, [](uint32_t) {});
+    std::chrono::duration<float, std::nano> duration = std::chrono::high_resolution_clock::now() - startTimePoint;
+
+    return duration.count() / jobCount;
+}
+
 MainEngine::MainEngine()
-        : sceneRoot(), currentCameraNode(nullptr) {
+        : currentCameraNode(nullptr), sceneRoot() {
 }
 
 void MainEngine::InitializeImGui(const char* GLSLVersion) {
@@ -217,6 +516,19 @@ MainEngine::~MainEngine() {
 }
 
 void MainEngine::Stop() {
+    // Everything that owns GL objects goes while the context is still current on this thread. The scene holds
+    // renderer slots and tile layers, so it goes before the renderer.
+    renderThread.reset();
+    if (window)
+        glfwMakeContextCurrent(window);
+
+    sceneRoot.Stop(this);
+    while (!sceneRoot.GetChildrenList().empty())
+        sceneRoot.RemoveChild(sceneRoot.GetChildrenList().back().get());
+    sceneEditQueue = SceneEditQueue();
+    currentCameraNode = nullptr;
+    renderer.reset();
+
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -238,29 +550,39 @@ void MainEngine::CheckGLErrors() {
 void MainEngine::PrepareScene() {
     auto map = CreateNodeMap();
     glm::vec2 mapSize = map->GetSize();
-    map->GetLocalTransform()->SetPosition(glm::vec3(-mapSize.x / 2 + 0.5f, -mapSize.y / 2 + 0.5f, 0));
+    map->MutableLocalTransform()->SetPosition(glm::vec3(-mapSize.x / 2 + 0.5f, -mapSize.y / 2 + 0.5f, 0));
     sceneRoot.AddChild(map);
 
     auto backgroundOneParallax = std::make_shared<ParallaxNode>(0.2f);
-    backgroundOneParallax->GetLocalTransform()->SetPosition({0.f, 0.f, -10.f});
+    backgroundOneParallax->MutableLocalTransform()->SetPosition({0.f, 0.f, -10.f});
     auto backgroundOne = CreateNodeMapBackground("res/other/background_one");
     glm::vec2 backgroundSize = backgroundOne->GetSize();
-    backgroundOne->GetLocalTransform()->SetPosition(glm::vec3(-mapSize.x / 2 + 0.5f, -mapSize.y / 2 + 0.5f, 0));
+    backgroundOne->MutableLocalTransform()->SetPosition(glm::vec3(-mapSize.x / 2 + 0.5f, -mapSize.y / 2 + 0.5f, 0));
     backgroundOneParallax->AddChild(backgroundOne);
     sceneRoot.AddChild(backgroundOneParallax);
 
     auto backgroundTwoParallax = std::make_shared<ParallaxNode>(0.4f);
-    backgroundTwoParallax->GetLocalTransform()->SetPosition({0.f, 0.f, -20.f});
+    backgroundTwoParallax->MutableLocalTransform()->SetPosition({0.f, 0.f, -20.f});
     auto backgroundTwo = CreateNodeMapBackground("res/other/background_two");
     backgroundSize = backgroundTwo->GetSize();
-    backgroundTwo->GetLocalTransform()->SetPosition(glm::vec3(-mapSize.x / 2 + 0.5f, -mapSize.y / 2 + 0.5f, 0));
+    backgroundTwo->MutableLocalTransform()->SetPosition(glm::vec3(-mapSize.x / 2 + 0.5f, -mapSize.y / 2 + 0.5f, 0));
     backgroundTwoParallax->AddChild(backgroundTwo);
     sceneRoot.AddChild(backgroundTwoParallax);
 
     auto playerNode = std::make_shared<PlayerNode>(this, renderer.get());
-    playerNode->GetLocalTransform()->SetPosition({-20.f, 0.f, 2.f});
+    playerNode->MutableLocalTransform()->SetPosition({-20.f, 0.f, 2.f});
     sceneRoot.AddChild(playerNode);
 
+    // Art outside TileMap.png goes through a material, the hearts cost one extra command per pass.
+    uint16_t heartMaterial = renderer->AddMaterial("res/textures/PixelArt/New Piskel.png", 512);
+    auto heartSprite = std::make_shared<Sprite>(glm::ivec2(0, 0), heartMaterial);
+    for (int heartIndex = 0; heartIndex < 3; heartIndex++) {
+        auto heartNode = std::make_shared<SpriteNode>(heartSprite, renderer.get());
+        heartNode->MutableLocalTransform()->SetPosition({-22.f + 2.f * static_cast<float>(heartIndex), 3.f, 1.f});
+        heartNode->SetIsStatic(true);
+        sceneRoot.AddChild(heartNode);
+    }
+
     sceneRoot.CalculateWorldTransform();
 }
 
@@ -274,30 +596,30 @@ std::shared_ptr<Map> MainEngine::CreateNodeMap() {
     auto stoneTileNode = std::make_shared<SpriteNode>(stoneSprite, renderer.get());
     auto horizontalTileNode = CreateRigidbodyTile(horizontalSprite);
     auto revertedHorizontalTileNode = CreateRigidbodyTile(horizontalSprite);
-    revertedHorizontalTileNode->GetLocalTransform()->SetRotation(glm::quat(glm::radians(180.f), glm::vec3(1.f, 0.f, 0.f)));
+    revertedHorizontalTileNode->MutableLocalTransform()->SetRotation(glm::quat(glm::radians(180.f), glm::vec3(1.f, 0.f, 0.f)));
 
     auto verticalTileNode = CreateRigidbodyTile(verticalSprite);
     auto revertedVerticalTileNode = CreateRigidbodyTile(verticalSprite);
-    revertedVerticalTileNode->GetLocalTransform()->SetRotation(glm::quat(glm::radians(180.f), glm::vec3(0.f, 1.f, 0.f)));
+    revertedVerticalTileNode->MutableLocalTransform()->SetRotation(glm::quat(glm::radians(180.f), glm::vec3(0.f, 1.f, 0.f)));
 
     auto leftUpTileNode = CreateRigidbodyTile(cornerSprite);
     auto rightUpTileNode = CreateRigidbodyTile(cornerSprite);
-    rightUpTileNode->GetLocalTransform()->SetRotation(glm::quat(glm::radians(180.f), glm::vec3(0.f, 1.f, 0.f)));
+    rightUpTileNode->MutableLocalTransform()->SetRotation(glm::quat(glm::radians(180.f), glm::vec3(0.f, 1.f, 0.f)));
 
     auto rightDownTileNode = CreateRigidbodyTile(cornerSprite);
-    rightDownTileNode->GetLocalTransform()->SetRotation(glm::quat({0.f, 0.f, glm::radians(180.f)}));
+    rightDownTileNode->MutableLocalTransform()->SetRotation(glm::quat({0.f, 0.f, glm::radians(180.f)}));
     auto leftDownTileNode = CreateRigidbodyTile(cornerSprite);
-    leftDownTileNode->GetLocalTransform()->SetRotation(glm::quat({glm::pi<float>(), 0.f, 0.f}));
+    leftDownTileNode->MutableLocalTransform()->SetRotation(glm::quat({glm::pi<float>(), 0.f, 0.f}));
 
     auto innerDownRightNode = std::make_shared<SpriteNode>( insideCornerSprite, renderer.get());
     auto innerDownLeftNode = std::make_shared<SpriteNode>( insideCornerSprite, renderer.get());
-    innerDownLeftNode->GetLocalTransform()->SetRotation(glm::quat({0.f, glm::radians(180.f), 0.f}));
+    innerDownLeftNode->MutableLocalTransform()->SetRotation(glm::quat({0.f, glm::radians(180.f), 0.f}));
 
     auto innerUpRightNode = std::make_shared<SpriteNode>( insideCornerSprite, renderer.get());
-    innerUpRightNode->GetLocalTransform()->SetRotation(glm::quat({glm::radians(180.f), glm::radians(180.f), 0.f}));
+    innerUpRightNode->MutableLocalTransform()->SetRotation(glm::quat({glm::radians(180.f), glm::radians(180.f), 0.f}));
 
     auto innerUpLeftNode = std::make_shared<SpriteNode>( insideCornerSprite, renderer.get());
-    innerUpLeftNode->GetLocalTransform()->SetRotation(glm::quat({glm::radians(180.f), 0.f, 0.f}));
+    innerUpLeftNode->MutableLocalTransform()->SetRotation(glm::quat({glm::radians(180.f), 0.f, 0.f}));
 
     std::map<char, Node*> nodesMap;
     nodesMap['H'] = horizontalTileNode.get();
@@ -314,7 +636,8 @@ std::shared_ptr<Map> MainEngine::CreateNodeMap() {
     nodesMap['['] = innerUpRightNode.get();
     nodesMap[' '] = nullptr;
     nodesMap['#'] = stoneTileNode.get();
-    return std::make_shared<Map>("res/other/map", nodesMap);
+    // The main map is mostly solid stone, which merges into a handful of quads.
+    return std::make_shared<Map>("res/other/map", nodesMap, renderer.get(), TileLayerMode::GreedyMesh);
 }
 
 std::shared_ptr<RigidbodyNode> MainEngine::CreateRigidbodyTile(const std::shared_ptr<Sprite>& sprite)
@@ -343,42 +666,42 @@ std::shared_ptr<class Map> MainEngine::CreateNodeMapBackground(std::string path)
     auto stoneTileNode = std::make_shared<SpriteNode>(stoneSprite, renderer.get());
     auto horizontalTileNode = std::make_shared<SpriteNode>(horizontalSprite, renderer.get());
     auto revertedHorizontalTileNode = std::make_shared<SpriteNode>(horizontalSprite, renderer.get());
-    revertedHorizontalTileNode->GetLocalTransform()->SetRotation(glm::quat(glm::radians(180.f), glm::vec3(1.f, 0.f, 0.f)));
+    revertedHorizontalTileNode->MutableLocalTransform()->SetRotation(glm::quat(glm::radians(180.f), glm::vec3(1.f, 0.f, 0.f)));
 
     auto verticalTileNode = std::make_shared<SpriteNode>(verticalSprite, renderer.get());
     auto revertedVerticalTileNode = std::make_shared<SpriteNode>(verticalSprite, renderer.get());
-    revertedVerticalTileNode->GetLocalTransform()->SetRotation(glm::quat(glm::radians(180.f), glm::vec3(0.f, 1.f, 0.f)));
+    revertedVerticalTileNode->MutableLocalTransform()->SetRotation(glm::quat(glm::radians(180.f), glm::vec3(0.f, 1.f, 0.f)));
 
     auto leftUpTileNode = std::make_shared<SpriteNode>(cornerSprite, renderer.get());
     auto rightUpTileNode = std::make_shared<SpriteNode>(cornerSprite, renderer.get());
-    rightUpTileNode->GetLocalTransform()->SetRotation(glm::quat(glm::radians(180.f), glm::vec3(0.f, 1.f, 0.f)));
+    rightUpTileNode->MutableLocalTransform()->SetRotation(glm::quat(glm::radians(180.f), glm::vec3(0.f, 1.f, 0.f)));
 
     auto rightDownTileNode = std::make_shared<SpriteNode>(cornerSprite, renderer.get());
-    rightDownTileNode->GetLocalTransform()->SetRotation(glm::quat({0.f, 0.f, glm::radians(180.f)}));
+    rightDownTileNode->MutableLocalTransform()->SetRotation(glm::quat({0.f, 0.f, glm::radians(180.f)}));
     auto leftDownTileNode = std::make_shared<SpriteNode>(cornerSprite, renderer.get());
-    leftDownTileNode->GetLocalTransform()->SetRotation(glm::quat({glm::pi<float>(), 0.f, 0.f}));
+    leftDownTileNode->MutableLocalTransform()->SetRotation(glm::quat({glm::pi<float>(), 0.f, 0.f}));
 
     auto innerDownRightNode = std::make_shared<SpriteNode>( insideCornerSprite, renderer.get());
     auto innerDownLeftNode = std::make_shared<SpriteNode>( insideCornerSprite, renderer.get());
-    innerDownLeftNode->GetLocalTransform()->SetRotation(glm::quat({0.f, glm::radians(180.f), 0.f}));
+    innerDownLeftNode->MutableLocalTransform()->SetRotation(glm::quat({0.f, glm::radians(180.f), 0.f}));
 
     auto innerUpRightNode = std::make_shared<SpriteNode>( insideCornerSprite, renderer.get());
-    innerUpRightNode->GetLocalTransform()->SetRotation(glm::quat({glm::radians(180.f), glm::radians(180.f), 0.f}));
+    innerUpRightNode->MutableLocalTransform()->SetRotation(glm::quat({glm::radians(180.f), glm::radians(180.f), 0.f}));
 
     auto innerUpLeftNode = std::make_shared<SpriteNode>( insideCornerSprite, renderer.get());
-    innerUpLeftNode->GetLocalTransform()->SetRotation(glm::quat({glm::radians(180.f), 0.f, 0.f}));
+    innerUpLeftNode->MutableLocalTransform()->SetRotation(glm::quat({glm::radians(180.f), 0.f, 0.f}));
 
     auto stalactiteTopNode = std::make_shared<SpriteNode>(stalactiteTop, renderer.get());
     auto flippedStalactiteTopNode = std::make_shared<SpriteNode>(stalactiteTop, renderer.get());
-    flippedStalactiteTopNode->GetLocalTransform()->SetRotation(glm::quat({glm::pi<float>(), 0.f, 0.f}));
+    flippedStalactiteTopNode->MutableLocalTransform()->SetRotation(glm::quat({glm::pi<float>(), 0.f, 0.f}));
 
     auto stalactiteCenterNode = std::make_shared<SpriteNode>(stalactiteCenter, renderer.get());
     auto flippedStalactiteCenterNode = std::make_shared<SpriteNode>(stalactiteCenter, renderer.get());
-    flippedStalactiteCenterNode->GetLocalTransform()->SetRotation(glm::quat({glm::pi<float>(), 0.f, 0.f}));
+    flippedStalactiteCenterNode->MutableLocalTransform()->SetRotation(glm::quat({glm::pi<float>(), 0.f, 0.f}));
 
     auto stalactiteBaseNode = std::make_shared<SpriteNode>(stalactiteBase, renderer.get());
     auto flippedStalactiteBaseNode = std::make_shared<SpriteNode>(stalactiteBase, renderer.get());
-    flippedStalactiteBaseNode->GetLocalTransform()->SetRotation(glm::quat({glm::pi<float>(), 0.f, 0.f}));
+    flippedStalactiteBaseNode->MutableLocalTransform()->SetRotation(glm::quat({glm::pi<float>(), 0.f, 0.f}));
 
     std::map<char, Node*> nodesMap;
     nodesMap['H'] = horizontalTileNode.get();
@@ -402,7 +725,7 @@ std::shared_ptr<class Map> MainEngine::CreateNodeMapBackground(std::string path)
     nodesMap['8'] = flippedStalactiteCenterNode.get();
     nodesMap['9'] = flippedStalactiteBaseNode.get();
 
-    return std::make_shared<Map>(path, nodesMap);
+    return std::make_shared<Map>(path, nodesMap, renderer.get());
 }
 
 GLFWwindow* MainEngine::GetWindow() const {
@@ -413,6 +736,22 @@ Node& MainEngine::GetSceneRoot() {
     return sceneRoot;
 }
 
+UpdateScheduler& MainEngine::GetUpdateScheduler() {
+    return updateScheduler;
+}
+
+JobSystem& MainEngine::GetJobSystem() {
+    return *jobSystem;
+}
+
+SpriteRenderer& MainEngine::GetRenderer() {
+    return *renderer;
+}
+
+SceneEditQueue& MainEngine::GetSceneEditQueue() {
+    return sceneEditQueue;
+}
+
 CameraNode* MainEngine::GetCurrentCameraNode() {
     return currentCameraNode;
 }
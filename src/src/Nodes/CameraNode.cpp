@@ -3,13 +3,21 @@
 #include "MainEngine.h"
 
 CameraNode::CameraNode(MainEngine* engine)
-        : camera(std::make_unique<Camera>()), engine(engine) {
+        : camera(std::make_unique<Camera>()), engine(engine), scheduler(nullptr) {
 
 }
 
-void CameraNode::Update(MainEngine* engine, float seconds, float deltaSeconds) {
-    Node::Update(engine, seconds, deltaSeconds);
+void CameraNode::OnStart(MainEngine* engine) {
+    scheduler = &engine->GetUpdateScheduler();
+    scheduler->Register<&CameraNode::UpdateCamera>(UpdatePhase::Camera, this);
+}
+
+void CameraNode::OnStop(MainEngine* engine) {
+    scheduler->Unregister<&CameraNode::UpdateCamera>(UpdatePhase::Camera, this);
+    scheduler = nullptr;
+}
 
+void CameraNode::UpdateCamera(MainEngine* engine, float seconds, float deltaSeconds) {
     if (engine->currentCameraNode != this) {
         return;
     }
@@ -24,13 +32,11 @@ void CameraNode::Update(MainEngine* engine, float seconds, float deltaSeconds) {
 }
 
 std::shared_ptr<Node> CameraNode::Clone() const {
-    std::shared_ptr<CameraNode> result(new CameraNode(Node::Clone().get()));
+    std::shared_ptr<CameraNode> result(new CameraNode());
     result->camera = std::make_unique<Camera>(*camera);
-    return Node::Clone();
-}
-
-CameraNode::CameraNode(Node* node)
-        : Node(*node), camera(std::make_unique<Camera>()) {
+    result->engine = engine;
+    CloneInto(*result);
+    return result;
 }
 
 void CameraNode::MakeCurrent() {
@@ -38,12 +44,13 @@ void CameraNode::MakeCurrent() {
 }
 
 CameraNode::CameraNode()
-: camera(nullptr), engine(nullptr) {
+: camera(nullptr), engine(nullptr), scheduler(nullptr) {
 
 }
 
 CameraNode::~CameraNode() {
-
+    if (scheduler != nullptr)
+        scheduler->Unregister<&CameraNode::UpdateCamera>(UpdatePhase::Camera, this);
 }
 
 float CameraNode::GetScale() const {
@@ -53,3 +60,15 @@ float CameraNode::GetScale() const {
 void CameraNode::SetScale(float scale) {
     camera->SetScale(scale);
 }
+
+Bounds2D CameraNode::GetVisibleBounds() const {
+    return camera->GetVisibleBounds();
+}
+
+glm::mat4 CameraNode::GetProjectionMatrix() const {
+    return camera->GetProjectionMatrix();
+}
+
+glm::mat4 CameraNode::GetViewMatrix() const {
+    return camera->GetViewMatrix();
+}
@@ -30,13 +30,16 @@ glm::vec2 CircleCollisionShape::GetSeparationVectorBetweenCircles(RigidbodyNode*
     auto thisCollisionShape = dynamic_cast<CircleCollisionShape*>(selfNode->GetCollisionShape().get());
     auto anotherCollisionShape = dynamic_cast<CircleCollisionShape*>(anotherNode->GetCollisionShape().get());
 
-    glm::vec2 thisPosition = glm::vec2(selfNode->GetWorldPosition());
-    glm::vec2 anotherPosition = glm::vec2(anotherNode->GetWorldPosition());
+    return GetSeparationVectorBetweenCircles(thisCollisionShape->radius, glm::vec2(selfNode->GetWorldPosition()),
+                                             anotherCollisionShape->radius, glm::vec2(anotherNode->GetWorldPosition()));
+}
 
+glm::vec2 CircleCollisionShape::GetSeparationVectorBetweenCircles(float thisRadius, glm::vec2 thisPosition,
+                                                                  float anotherRadius, glm::vec2 anotherPosition) {
     glm::vec2 thisToAnotherPosition = thisPosition - anotherPosition;
 
    return glm::normalize(thisToAnotherPosition) *
-           (thisCollisionShape->radius + anotherCollisionShape->radius - glm::length(thisToAnotherPosition));
+           (thisRadius + anotherRadius - glm::length(thisToAnotherPosition));
 }
 
 bool CircleCollisionShape::IsCircleCollidingWithRectangle(RigidbodyNode* selfNode, RigidbodyNode* anotherNode) {
@@ -72,19 +75,12 @@ glm::vec2 CircleCollisionShape::GetSeparationVectorBetweenCircleAndRectangle(Rig
 
     if (thisPosition == nearestPoint)
     {
-        auto temporaryRectangle = std::make_shared<RectangleCollisionShape>(thisCollisionShape->radius * 2, thisCollisionShape->radius * 2);
-        auto temporaryRigidbody = std::make_unique<RigidbodyNode>(temporaryRectangle);
-        temporaryRigidbody->GetLocalTransform()->SetPosition({thisPosition, 0.f});
-        temporaryRigidbody->CalculateWorldTransform();
+        RectangleCollisionShape circleBounds(thisCollisionShape->radius * 2, thisCollisionShape->radius * 2);
 
-        return RectangleCollisionShape::GetSeparationVectorBetweenRectangles(temporaryRigidbody.get(), anotherNode);
+        return RectangleCollisionShape::GetSeparationVectorBetweenRectangles(&circleBounds, glm::vec3(thisPosition, 0.f),
+                                                                             anotherCollisionShape, glm::vec3(anotherPosition, 0.f));
     }
 
-    auto temporaryCircle = std::make_shared<CircleCollisionShape>(0);
-    auto temporaryRigidbody = std::make_unique<RigidbodyNode>(temporaryCircle);
-    temporaryRigidbody->GetLocalTransform()->SetPosition({nearestPoint, 0.f});
-    temporaryRigidbody->CalculateWorldTransform();
-
-    return CircleCollisionShape::GetSeparationVectorBetweenCircles(selfNode, temporaryRigidbody.get());
+    return CircleCollisionShape::GetSeparationVectorBetweenCircles(thisCollisionShape->radius, thisPosition, 0.f, nearestPoint);
 
 }
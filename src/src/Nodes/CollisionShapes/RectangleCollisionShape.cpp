@@ -43,9 +43,12 @@ bool RectangleCollisionShape::IsRectanglesColliding(RigidbodyNode* selfNode, Rig
     auto thisCollisionShape = dynamic_cast<RectangleCollisionShape *>(selfNode->GetCollisionShape().get());
     auto anotherCollisionShape = dynamic_cast<RectangleCollisionShape *>(anotherNode->GetCollisionShape().get());
 
-    glm::vec3 thisPosition = selfNode->GetWorldPosition();
-    glm::vec3 anotherPosition = anotherNode->GetWorldPosition();
+    return IsRectanglesColliding(thisCollisionShape, selfNode->GetWorldPosition(),
+                                 anotherCollisionShape, anotherNode->GetWorldPosition());
+}
 
+bool RectangleCollisionShape::IsRectanglesColliding(const RectangleCollisionShape* thisCollisionShape, glm::vec3 thisPosition,
+                                                    const RectangleCollisionShape* anotherCollisionShape, glm::vec3 anotherPosition) {
     return thisCollisionShape->GetRight(thisPosition) > anotherCollisionShape->GetLeft(anotherPosition)
            && thisCollisionShape->GetLeft(thisPosition) < anotherCollisionShape->GetRight(anotherPosition)
            && thisCollisionShape->GetTop(thisPosition) > anotherCollisionShape->GetBottom(anotherPosition)
@@ -57,9 +60,14 @@ RectangleCollisionShape::GetSeparationVectorBetweenRectangles(RigidbodyNode* sel
     auto thisCollisionShape = dynamic_cast<RectangleCollisionShape *>(selfNode->GetCollisionShape().get());
     auto anotherCollisionShape = dynamic_cast<RectangleCollisionShape *>(anotherNode->GetCollisionShape().get());
 
-    glm::vec3 thisPosition = selfNode->GetWorldPosition();
-    glm::vec3 anotherPosition = anotherNode->GetWorldPosition();
+    return GetSeparationVectorBetweenRectangles(thisCollisionShape, selfNode->GetWorldPosition(),
+                                                anotherCollisionShape, anotherNode->GetWorldPosition());
+}
 
+glm::vec2 RectangleCollisionShape::GetSeparationVectorBetweenRectangles(const RectangleCollisionShape* thisCollisionShape,
+                                                                        glm::vec3 thisPosition,
+                                                                        const RectangleCollisionShape* anotherCollisionShape,
+                                                                        glm::vec3 anotherPosition) {
     float leftSeparation = thisCollisionShape->GetRight(thisPosition) - anotherCollisionShape->GetLeft(anotherPosition);
     float rightSeparation = anotherCollisionShape->GetRight(anotherPosition) - thisCollisionShape->GetLeft(thisPosition);
     float topSeparation = thisCollisionShape->GetTop(thisPosition) - anotherCollisionShape->GetBottom(anotherPosition);
@@ -1,23 +1,124 @@
 #include "include/Nodes/Map.h"
 
 #include <fstream>
+#include <glm/gtc/packing.hpp>
 
-Map::Map(const std::string &path, const std::map<char, struct Node *> &nodesMap) {
+#include "Nodes/SpriteNode.h"
+#include "Nodes/SpriteArrayNode.h"
+#include "Sprite.h"
+#include "SpriteInstance.h"
+#include "SpriteRenderer.h"
+#include "TileLayer.h"
+#include "LoggingMacros.h"
+
+namespace {
+    struct LayerTile {
+        uint16_t cell = TileLayer::emptyCell;
+        // False when the prototype is nothing but its sprite.
+        bool needsNode = true;
+        // The prototype without its sprite, cloned for every tile that needs a node. Null when the tile keeps its
+        // sprite node and the prototype itself is cloned.
+        std::shared_ptr<Node> nodePrototype;
+    };
+
+    bool IsSpriteNode(Node* node) {
+        return dynamic_cast<SpriteNode*>(node) != nullptr;
+    }
+
+    LayerTile ResolveLayerTile(Node* prototype, const SpriteRenderer& renderer) {
+        LayerTile result;
+
+        glm::mat4 spriteTransform = prototype->GetLocalTransform()->GetMatrix();
+        auto* spriteNode = dynamic_cast<SpriteNode*>(prototype);
+        if (spriteNode == nullptr) {
+            spriteNode = static_cast<SpriteNode*>(prototype->GetChild(IsSpriteNode));
+            if (spriteNode == nullptr)
+                return result;
+            spriteTransform = spriteTransform * spriteNode->GetLocalTransform()->GetMatrix();
+        }
+
+        // Animated sprites keep their node, so do sprites that do not fill exactly one cell. Tile layers only sample
+        // the default material.
+        if (dynamic_cast<SpriteArrayNode*>(spriteNode) != nullptr || spriteNode->getSprite()->GetMaterial() != 0)
+            return result;
+
+        SpriteInstance instance{};
+        if (!PackSpriteTransform(spriteTransform, instance) || instance.position.x != 0.f || instance.position.y != 0.f
+            || glm::unpackHalf1x16(instance.scale[0]) != 1.f || glm::unpackHalf1x16(instance.scale[1]) != 1.f)
+            return result;
+
+        uint16_t tileIndex = renderer.GetTileIndex(spriteNode->getSprite()->GetTileMapPosition());
+        if (tileIndex > TileLayer::maxTileIndex)
+            return result;
+
+        result.cell = TileLayer::PackCell(tileIndex, instance.flags);
+        result.needsNode = spriteNode != prototype;
+        if (result.needsNode) {
+            // Stripped once here instead of cloning and removing the sprite for every tile.
+            result.nodePrototype = prototype->Clone();
+            while (Node* spriteChild = result.nodePrototype->GetChild(IsSpriteNode)) {
+                // A child the clone does not own would be found again forever.
+                if (result.nodePrototype->RemoveChild(spriteChild) == nullptr) {
+                    SPDLOG_ERROR("Cloned map prototype holds a sprite it is not the parent of");
+                    break;
+                }
+            }
+        }
+        return result;
+    }
+}
+
+Map::Map(const std::string &path, const std::map<char, struct Node *> &nodesMap) : Map(path, nodesMap, nullptr) {}
+
+Map::Map(const std::string &path, const std::map<char, struct Node *> &nodesMap, SpriteRenderer *tileLayerRenderer,
+         TileLayerMode tileLayerMode)
+        : tileLayerRenderer(tileLayerRenderer) {
     std::ifstream file(path);
 
     std::string FileLine;
     int lineNumber = 0, characterNumber = 0;
     size = glm::vec2{0, 0};
 
+    std::map<char, LayerTile> layerTiles;
+    std::vector<std::vector<uint16_t>> layerRows;
+
     while (std::getline(file, FileLine)) {
+        std::vector<uint16_t>& layerRow = layerRows.emplace_back();
+
         for (char character : FileLine) {
-            if (nodesMap.at(character) != nullptr)
+            Node* prototype = nodesMap.at(character);
+            uint16_t layerCell = TileLayer::emptyCell;
+
+            if (prototype != nullptr)
             {
-                auto tile = nodesMap.at(character)->Clone();
-                tile->GetLocalTransform()->SetPosition(glm::vec3(characterNumber, -lineNumber, 0));
-                AddChild(tile);
+                std::shared_ptr<Node> tile;
+                if (tileLayerRenderer != nullptr) {
+                    auto layerTile = layerTiles.find(character);
+                    if (layerTile == layerTiles.end())
+                        layerTile = layerTiles.emplace(character, ResolveLayerTile(prototype, *tileLayerRenderer)).first;
+
+                    layerCell = layerTile->second.cell;
+                    if (layerTile->second.needsNode) {
+                        const std::shared_ptr<Node>& nodePrototype = layerTile->second.nodePrototype;
+                        tile = nodePrototype != nullptr ? nodePrototype->Clone() : prototype->Clone();
+                    }
+                } else {
+                    tile = prototype->Clone();
+                }
+
+                if (tile != nullptr) {
+                    tile->MutableLocalTransform()->SetPosition(glm::vec3(characterNumber, -lineNumber, 0));
+                    AddChild(tile);
+
+                    // Map tiles do not move, so their sprites are baked right away.
+                    std::vector<Node*> tileSprites;
+                    tile->GetAllNodes(tileSprites, IsSpriteNode);
+                    for (Node* tileSprite : tileSprites)
+                        static_cast<SpriteNode*>(tileSprite)->SetIsStatic(true);
+                }
             }
 
+            layerRow.push_back(layerCell);
             characterNumber++;
         }
         size.x = std::max(size.x, (float)characterNumber);
@@ -29,12 +130,36 @@ Map::Map(const std::string &path, const std::map<char, struct Node *> &nodesMap)
     for (auto& node : GetChildrenList()) {
         glm::vec3 position = node->GetLocalTransform()->GetPosition();
         position.y += size.y;
-        node->GetLocalTransform()->SetPosition(position);
+        node->MutableLocalTransform()->SetPosition(position);
     }
 
     file.close();
+
+    if (tileLayerRenderer != nullptr) {
+        glm::ivec2 layerSize(static_cast<int>(size.x), lineNumber);
+        std::vector<uint16_t> cells;
+        cells.reserve(layerSize.x * layerSize.y);
+        for (std::vector<uint16_t>& layerRow : layerRows) {
+            layerRow.resize(layerSize.x, TileLayer::emptyCell);
+            cells.insert(cells.end(), layerRow.begin(), layerRow.end());
+        }
+
+        tileLayer = std::make_unique<TileLayer>(layerSize, std::move(cells), GetWorldTransformMatrix(), tileLayerMode);
+        tileLayerRenderer->AddTileLayer(tileLayer.get());
+    }
+}
+
+Map::~Map() {
+    if (tileLayer != nullptr)
+        tileLayerRenderer->RemoveTileLayer(tileLayer.get());
 }
 
 const glm::vec2 &Map::GetSize() const {
     return size;
 }
+
+void Map::ApplyRenderLayer(uint8_t layer) {
+    Node::ApplyRenderLayer(layer);
+    if (tileLayer != nullptr)
+        tileLayer->SetRenderLayer(layer);
+}
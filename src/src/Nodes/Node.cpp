@@ -2,16 +2,29 @@
 #include "LoggingMacros.h"
 
 Node::Node()
-: localTransform(std::make_shared<Transform>()), worldTransformMatrix(1.f)
+: localTransform(std::make_shared<Transform>()), appliedTransform(nullptr), appliedTransformVersion(0),
+  worldTransformMatrix(1.f), parent(nullptr), indexInParent(0),
+  renderLayer(0), ownRenderLayer(0), wasDirty(true), isStarted(false)
 {
 
 }
 
-Transform* Node::GetLocalTransform()
+const Transform* Node::GetLocalTransform() const
 {
     return localTransform.get();
 }
 
+Transform* Node::MutableLocalTransform()
+{
+    if (localTransform.use_count() > 1)
+    {
+        localTransform = std::make_shared<Transform>(*localTransform);
+        appliedTransform = nullptr;
+    }
+
+    return localTransform.get();
+}
+
 const glm::mat4* Node::GetWorldTransformMatrix() const
 {
     return &worldTransformMatrix;
@@ -20,13 +33,18 @@ const glm::mat4* Node::GetWorldTransformMatrix() const
 void Node::Draw()
 {
     glm::mat4 WorldMatrix = *GetWorldTransformMatrix();
-    Draw(WorldMatrix, localTransform->isDirty);
+    Draw(WorldMatrix, IsLocalTransformDirty());
 }
 
 void Node::CalculateWorldTransform()
 {
     glm::mat4 TempTransformMatrix = glm::mat4(1.f);
-    CalculateWorldTransform(TempTransformMatrix, localTransform->isDirty);
+    CalculateWorldTransform(TempTransformMatrix, IsLocalTransformDirty());
+}
+
+bool Node::IsLocalTransformDirty() const
+{
+    return appliedTransform != localTransform.get() || appliedTransformVersion != localTransform->GetVersion();
 }
 
 void Node::Draw(glm::mat4& parentTransform, bool isDirty)
@@ -39,12 +57,14 @@ void Node::Draw(glm::mat4& parentTransform, bool isDirty)
 
 void Node::CalculateWorldTransform(glm::mat4& parentTransform, bool isDirty)
 {
-    isDirty |= localTransform->isDirty;
+    isDirty |= IsLocalTransformDirty();
     wasDirty = isDirty;
     if (isDirty)
     {
         worldTransformMatrix = parentTransform * localTransform->GetMatrix();
-        localTransform->isDirty = false;
+        appliedTransform = localTransform.get();
+        appliedTransformVersion = localTransform->GetVersion();
+        OnWorldTransformChanged();
     }
 
 
@@ -59,16 +79,50 @@ void Node::AddChild(std::shared_ptr<Node> newChild)
     if (newChild.get() == this || newChild.get() == parent)
         return;
 
+    // The layer is only reapplied once the new parent is known.
+    if (newChild->parent != nullptr)
+        newChild->parent->DetachChild(newChild.get());
+
     newChild->parent = this;
+    newChild->indexInParent = static_cast<uint32_t>(childrenList.size());
     childrenList.push_back(newChild);
-    newChild->CalculateWorldTransform(worldTransformMatrix, true);
+    childrenList.back()->CalculateWorldTransform(worldTransformMatrix, true);
+
+    uint8_t childLayer = newChild->ownRenderLayer != 0 ? newChild->ownRenderLayer : renderLayer;
+    if (newChild->renderLayer != childLayer)
+        newChild->ApplyRenderLayer(childLayer);
 }
 
-void Node::Update(class MainEngine* engine, float seconds, float deltaSeconds)
+std::shared_ptr<Node> Node::RemoveChild(Node* child)
 {
-    for (std::shared_ptr<Node> childNode : childrenList) {
-        childNode->Update(engine, seconds, deltaSeconds);
+    if (child == nullptr || child->parent != this)
+        return nullptr;
+
+    std::shared_ptr<Node> removedChild = DetachChild(child);
+    if (removedChild->ownRenderLayer == 0 && removedChild->renderLayer != 0)
+        removedChild->ApplyRenderLayer(0);
+    return removedChild;
+}
+
+std::shared_ptr<Node> Node::DetachChild(Node* child)
+{
+    uint32_t index = child->indexInParent;
+    std::shared_ptr<Node> removedChild = std::move(childrenList[index]);
+
+    if (index != childrenList.size() - 1)
+    {
+        childrenList[index] = std::move(childrenList.back());
+        childrenList[index]->indexInParent = index;
     }
+    childrenList.pop_back();
+
+    removedChild->parent = nullptr;
+    return removedChild;
+}
+
+void Node::OnWorldTransformChanged()
+{
+
 }
 
 bool Node::WasDirtyThisFrame() const
@@ -76,16 +130,45 @@ bool Node::WasDirtyThisFrame() const
     return wasDirty;
 }
 
+void Node::SetRenderLayer(uint8_t layer)
+{
+    ownRenderLayer = layer;
+    if (layer == 0 && parent != nullptr)
+        layer = parent->renderLayer;
+
+    if (layer != renderLayer)
+        ApplyRenderLayer(layer);
+}
+
+void Node::ApplyRenderLayer(uint8_t layer)
+{
+    renderLayer = layer;
+
+    for (const std::shared_ptr<Node>& child: childrenList)
+    {
+        if (child->ownRenderLayer == 0)
+            child->ApplyRenderLayer(layer);
+    }
+}
+
+uint8_t Node::GetRenderLayer() const
+{
+    return renderLayer;
+}
+
 std::shared_ptr<Node> Node::Clone() const {
     auto result = std::make_shared<Node>();
-    result->localTransform= std::make_shared<Transform>(*this->localTransform) ;
-    result->wasDirty = true;
+    CloneInto(*result);
+    return result;
+}
+
+void Node::CloneInto(Node& clone) const {
+    clone.localTransform = localTransform;
+    clone.wasDirty = true;
 
     for (const auto& node : childrenList) {
-        result->AddChild(node->Clone());
+        clone.AddChild(node->Clone());
     }
-
-    return result;
 }
 
 glm::vec3 Node::GetWorldPosition() const {
@@ -105,7 +188,35 @@ Node* Node::GetParent() const {
 }
 
 void Node::Start(struct MainEngine* engine) {
-    for (std::shared_ptr<Node> childNode : childrenList) {
+    if (!isStarted) {
+        isStarted = true;
+        OnStart(engine);
+    }
+
+    for (const std::shared_ptr<Node>& childNode : childrenList) {
         childNode->Start(engine);
     }
 }
+
+void Node::Stop(struct MainEngine* engine) {
+    for (const std::shared_ptr<Node>& childNode : childrenList) {
+        childNode->Stop(engine);
+    }
+
+    if (isStarted) {
+        isStarted = false;
+        OnStop(engine);
+    }
+}
+
+bool Node::IsStarted() const {
+    return isStarted;
+}
+
+void Node::OnStart(struct MainEngine* engine) {
+
+}
+
+void Node::OnStop(struct MainEngine* engine) {
+
+}
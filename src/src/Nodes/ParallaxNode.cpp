@@ -1,28 +1,49 @@
 #include "Nodes/ParallaxNode.h"
 #include "MainEngine.h"
 #include "Nodes/CameraNode.h"
+#include "SpriteRenderer.h"
 #include "LoggingMacros.h"
 
-void ParallaxNode::Start(struct MainEngine* engine) {
-    Node::Start(engine);
+void ParallaxNode::OnStart(struct MainEngine* engine) {
+    scheduler = &engine->GetUpdateScheduler();
+    scheduler->Register<&ParallaxNode::UpdateParallax>(UpdatePhase::Late, this);
+
+    renderer = &engine->GetRenderer();
+    scrollLayer = renderer->AddRenderLayer();
+    SetRenderLayer(scrollLayer);
 
     CameraNode* currentCamera = engine->GetCurrentCameraNode();
 
     lastCameraLocation = currentCamera->GetWorldPosition();
 }
 
-void ParallaxNode::Update(MainEngine* engine, float seconds, float deltaSeconds) {
+void ParallaxNode::OnStop(struct MainEngine* engine) {
+    scheduler->Unregister<&ParallaxNode::UpdateParallax>(UpdatePhase::Late, this);
+    scheduler = nullptr;
+
+    // The layer goes back to the renderer, a restarted node takes whichever one is free then.
+    renderer->RemoveRenderLayer(scrollLayer);
+    renderer = nullptr;
+    scrollLayer = 0;
+    SetRenderLayer(0);
+}
+
+void ParallaxNode::UpdateParallax(MainEngine* engine, float seconds, float deltaSeconds) {
     CameraNode* currentCamera = engine->GetCurrentCameraNode();
     glm::vec3 currentCameraLocation = currentCamera->GetWorldPosition();
 
     glm::vec3 cameraOffset = (lastCameraLocation - currentCameraLocation) * lagFactor;
     cameraOffset.z = 0;
 
-    glm::vec3 newPosition = GetLocalTransform()->GetPosition() - cameraOffset;
-    GetLocalTransform()->SetPosition(newPosition);
+    if (scrollLayer != 0) {
+        scrollOffset -= glm::vec2(cameraOffset);
+        renderer->SetRenderLayerOffset(scrollLayer, scrollOffset);
+    } else {
+        glm::vec3 newPosition = GetLocalTransform()->GetPosition() - cameraOffset;
+        MutableLocalTransform()->SetPosition(newPosition);
+    }
 
     lastCameraLocation = currentCameraLocation;
-    Node::Update(engine, seconds, deltaSeconds);
 }
 
 void ParallaxNode::Draw(glm::mat4& parentTransform, bool isDirty) {
@@ -38,6 +59,13 @@ void ParallaxNode::SetLagFactor(float lagFactor) {
 }
 
 ParallaxNode::ParallaxNode(float lagFactor)
-: lagFactor(lagFactor), lastCameraLocation(0.f) {
+: lagFactor(lagFactor), lastCameraLocation(0.f), scheduler(nullptr), renderer(nullptr), scrollLayer(0), scrollOffset(0.f) {
+
+}
 
+ParallaxNode::~ParallaxNode() {
+    if (scheduler != nullptr)
+        scheduler->Unregister<&ParallaxNode::UpdateParallax>(UpdatePhase::Late, this);
+    if (renderer != nullptr)
+        renderer->RemoveRenderLayer(scrollLayer);
 }
@@ -10,7 +10,7 @@
 #include "Sprite.h"
 
 PlayerNode::PlayerNode(MainEngine* engine, SpriteRenderer* renderer)
-: RigidbodyNode(CollisionShapeFactory::CreateFactory()->CreateCircleCollisionShape(0.5f)) {
+: RigidbodyNode(CollisionShapeFactory::CreateFactory()->CreateCircleCollisionShape(0.5f)), input(0.f) {
     playerSpeed = 7.f;
     fallGravityFactor = 0.8f;
     buttonPressJumpGravityFactor = 0.5f;
@@ -22,27 +22,51 @@ PlayerNode::PlayerNode(MainEngine* engine, SpriteRenderer* renderer)
 
     auto cameraNode = std::make_shared<CameraNode>(engine);
     cameraNode->MakeCurrent();
-    cameraNode->GetLocalTransform()->SetPosition({0.f, 2.f, 20.f});
+    cameraNode->MutableLocalTransform()->SetPosition({0.f, 2.f, 20.f});
     AddChild(cameraNode);
 
     auto jumpTrigger = std::make_shared<RigidbodyNode>(CollisionShapeFactory::CreateFactory()->CreateRectangleCollisionShape(0.15f, 0.7f));
-    jumpTrigger->GetLocalTransform()->SetPosition({0.f, -0.5, 0.f});
+    jumpTrigger->MutableLocalTransform()->SetPosition({0.f, -0.5, 0.f});
     jumpTrigger->SetIsTrigger(true);
     AddChild(jumpTrigger);
 
 #ifdef DEBUG
     auto debugSprite = std::make_shared<Sprite>(glm::vec<2, int>(2, 0));
     auto debugSpriteNode = std::make_shared<SpriteNode>(debugSprite, renderer);
-    debugSpriteNode->GetLocalTransform()->SetScale({0.7f, 0.15f, 1.f});
-    debugSpriteNode->GetLocalTransform()->SetPosition({0.f, 0.f, 10.f});
+    debugSpriteNode->MutableLocalTransform()->SetScale({0.7f, 0.15f, 1.f});
+    debugSpriteNode->MutableLocalTransform()->SetPosition({0.f, 0.f, 10.f});
     jumpTrigger->AddChild(debugSpriteNode);
 #endif
 
 }
 
-void PlayerNode::Update(struct MainEngine *engine, float seconds, float deltaSeconds) {
-    glm::vec2 input = GetMovementInput(engine);
+PlayerNode::~PlayerNode() {
+    if (scheduler == nullptr)
+        return;
 
+    scheduler->Unregister<&PlayerNode::HandleInput>(UpdatePhase::Input, this);
+    scheduler->Unregister<&PlayerNode::UpdateMovement>(UpdatePhase::Gameplay, this);
+}
+
+void PlayerNode::OnStart(struct MainEngine* engine) {
+    RigidbodyNode::OnStart(engine);
+
+    scheduler->Register<&PlayerNode::HandleInput>(UpdatePhase::Input, this);
+    scheduler->Register<&PlayerNode::UpdateMovement>(UpdatePhase::Gameplay, this);
+}
+
+void PlayerNode::OnStop(struct MainEngine* engine) {
+    scheduler->Unregister<&PlayerNode::HandleInput>(UpdatePhase::Input, this);
+    scheduler->Unregister<&PlayerNode::UpdateMovement>(UpdatePhase::Gameplay, this);
+
+    RigidbodyNode::OnStop(engine);
+}
+
+void PlayerNode::HandleInput(struct MainEngine* engine, float seconds, float deltaSeconds) {
+    input = GetMovementInput(engine);
+}
+
+void PlayerNode::UpdateMovement(struct MainEngine *engine, float seconds, float deltaSeconds) {
     glm::vec2 newAcceleration = GetAcceleration();
 
     if (std::abs(GetVelocity().x) < playerSpeed && std::abs(input.x) > 0 )
@@ -78,13 +102,10 @@ void PlayerNode::Update(struct MainEngine *engine, float seconds, float deltaSec
 
     if (velocity.x > 0)
     {
-        playerSprite->GetLocalTransform()->SetRotation({{0.f, 0.f, 0.f}});
+        playerSprite->MutableLocalTransform()->SetRotation({{0.f, 0.f, 0.f}});
     } else {
-        playerSprite->GetLocalTransform()->SetRotation({{0.f, -glm::pi<float>(), 0.f}});
+        playerSprite->MutableLocalTransform()->SetRotation({{0.f, -glm::pi<float>(), 0.f}});
     }
-
-
-    RigidbodyNode::Update(engine, seconds, deltaSeconds);
 }
 
 glm::vec2 PlayerNode::GetMovementInput(MainEngine *engine) {
@@ -3,12 +3,14 @@
 #include "Nodes/CollisionShapes/CollisionShape.h"
 
 #include "MainEngine.h"
+#include "FrameAllocator.h"
 #include "LoggingMacros.h"
 #include "Nodes/CollisionShapes/RectangleCollisionShape.h"
 #include "Nodes/CollisionShapes/CircleCollisionShape.h"
 
 RigidbodyNode::RigidbodyNode(std::shared_ptr<CollisionShapeFactory> collisionShapeFactory)
-        : acceleration(0.f), newAcceleration(0.f), velocity(0.f), isKinematic(false), isTrigger(false) {
+        : acceleration(0.f), newAcceleration(0.f), velocity(0.f), isKinematic(false), isTrigger(false),
+          scheduler(nullptr) {
     collisionShape = collisionShapeFactory->Build();
 }
 
@@ -29,31 +31,38 @@ void RigidbodyNode::SetVelocity(const glm::vec2& velocity) {
 }
 
 std::shared_ptr<Node> RigidbodyNode::Clone() const {
-    std::shared_ptr<RigidbodyNode> result(new RigidbodyNode(*Node::Clone()));
+    auto result = std::make_shared<RigidbodyNode>(collisionShape);
     result->acceleration = acceleration;
     result->velocity = velocity;
-    result->collisionShape = collisionShape->Clone();
     result->isKinematic = isKinematic;
     result->isTrigger = isTrigger;
+    CloneInto(*result);
     return result;
 }
 
-RigidbodyNode::RigidbodyNode(const Node& obj)
-        : Node(obj), acceleration(0.f), newAcceleration(0.f), velocity(0.f), isTrigger(false) {
+RigidbodyNode::~RigidbodyNode() {
+    if (scheduler != nullptr && !isKinematic)
+        scheduler->Unregister<&RigidbodyNode::UpdatePhysics>(UpdatePhase::Physics, this);
+}
 
+void RigidbodyNode::OnStart(MainEngine* engine) {
+    scheduler = &engine->GetUpdateScheduler();
+    if (!isKinematic)
+        scheduler->Register<&RigidbodyNode::UpdatePhysics>(UpdatePhase::Physics, this);
 }
 
-void RigidbodyNode::Update(MainEngine* engine, float seconds, float deltaSeconds) {
-    if (isKinematic)
-        return;
+void RigidbodyNode::OnStop(MainEngine* engine) {
+    if (!isKinematic)
+        scheduler->Unregister<&RigidbodyNode::UpdatePhysics>(UpdatePhase::Physics, this);
+    scheduler = nullptr;
+}
 
+void RigidbodyNode::UpdatePhysics(MainEngine* engine, float seconds, float deltaSeconds) {
     if (!isTrigger && deltaSeconds < 1.f / 30.f)
         HandlePhysics(deltaSeconds);
 
     overlappedNodesThisFrame.clear();
     HandleCollisions(engine);
-
-    Node::Update(engine, seconds, deltaSeconds);
 }
 
 void RigidbodyNode::HandlePhysics(float deltaSeconds) {
@@ -62,11 +71,11 @@ void RigidbodyNode::HandlePhysics(float deltaSeconds) {
     velocity += 0.5f * (acceleration + newAcceleration) * deltaSeconds;
     acceleration = newAcceleration;
 
-    GetLocalTransform()->SetPosition(newPosition);
+    MutableLocalTransform()->SetPosition(newPosition);
 }
 
 void RigidbodyNode::HandleCollisions(MainEngine* engine) {
-    std::vector<Node*> foundNodes;
+    FrameVector<Node*> foundNodes;
     engine->GetSceneRoot().GetAllNodes(foundNodes, [this](Node* node) -> bool {
         auto* rigidbodyNode = dynamic_cast<RigidbodyNode*>(node);
         return rigidbodyNode != nullptr && rigidbodyNode != this;
@@ -107,10 +116,10 @@ void RigidbodyNode::Collide(RigidbodyNode* anotherRigidbodyNode) {
 
         glm::vec3 anotherPosition = anotherRigidbodyNode->GetLocalTransform()->GetPosition();
         anotherPosition -= glm::vec3(separationVector, 0.f);
-        anotherRigidbodyNode->GetLocalTransform()->SetPosition(anotherPosition);
+        anotherRigidbodyNode->MutableLocalTransform()->SetPosition(anotherPosition);
     }
 
-    GetLocalTransform()->SetPosition(position);
+    MutableLocalTransform()->SetPosition(position);
 }
 
 glm::vec2 RigidbodyNode::CalculateSeparationVector(RigidbodyNode* selfRigidbody, RigidbodyNode* anotherRigidbody) {
@@ -151,6 +160,13 @@ bool RigidbodyNode::IsKinematic() const {
 }
 
 void RigidbodyNode::SetIsKinematic(bool isKinematic) {
+    if (scheduler != nullptr && isKinematic != RigidbodyNode::isKinematic) {
+        if (isKinematic)
+            scheduler->Unregister<&RigidbodyNode::UpdatePhysics>(UpdatePhase::Physics, this);
+        else
+            scheduler->Register<&RigidbodyNode::UpdatePhysics>(UpdatePhase::Physics, this);
+    }
+
     RigidbodyNode::isKinematic = isKinematic;
 }
 
@@ -163,7 +179,8 @@ void RigidbodyNode::SetCollisionShape(const std::shared_ptr<CollisionShape>& col
 }
 
 RigidbodyNode::RigidbodyNode(std::shared_ptr<struct CollisionShape> collisionShape)
-        : acceleration(0.f), newAcceleration(0.f), velocity(0.f), isKinematic(false) {
+        : acceleration(0.f), newAcceleration(0.f), velocity(0.f), isKinematic(false), isTrigger(false),
+          scheduler(nullptr) {
     this->collisionShape = collisionShape;
 }
 
@@ -171,7 +188,7 @@ bool RigidbodyNode::IsTrigger() const {
     return isTrigger;
 }
 
-std::vector<RigidbodyNode*> RigidbodyNode::GetOverlappedNodesThisFrame() {
+const std::vector<RigidbodyNode*>& RigidbodyNode::GetOverlappedNodesThisFrame() const {
     return overlappedNodesThisFrame;
 }
 
@@ -1,37 +1,123 @@
 #include "Nodes/SpriteNode.h"
 #include "Sprite.h"
 #include "SpriteRenderer.h"
+#include "SpriteGrid.h"
+#include "SpriteInstance.h"
+#include "LoggingMacros.h"
 
 SpriteNode::SpriteNode(const std::shared_ptr<Sprite> &sprite, SpriteRenderer* renderer)
-        :Node(), sprite(sprite), renderer(renderer) {
+        :Node(), sprite(sprite), renderer(renderer), rendererIndex(0), isInRenderer(true), gridBounds(), gridCell(SpriteGrid::noCell),
+          gridIndex(0), palette(0), cleanFrames(0), needsMatrixInstance(false), isStaticHint(false), hasSpriteChangedWhileStatic(false),
+          staticBatch(nullptr), staticChunk(0), staticIndex(0) {
     renderer->AddNode(this);
 }
 
 SpriteNode::~SpriteNode() {
+    if (renderer != nullptr && isInRenderer)
+        renderer->RemoveNode(this);
+}
+
+// Sprites are drawn from construction on, so only a stopped node has to get its slot back. A stopped node's changes
+// are not marked, AddNode() uploads it whole.
+void SpriteNode::OnStart(struct MainEngine* engine) {
+    if (renderer == nullptr || isInRenderer)
+        return;
+
+    renderer->AddNode(this);
+    isInRenderer = true;
+}
+
+void SpriteNode::OnStop(struct MainEngine* engine) {
+    if (renderer == nullptr || !isInRenderer)
+        return;
+
     renderer->RemoveNode(this);
+    isInRenderer = false;
 }
 
 void SpriteNode::Draw(glm::mat4 &ParentTransform, bool IsDirty) {
     Node::Draw(ParentTransform, IsDirty);
 }
 
+void SpriteNode::OnWorldTransformChanged() {
+    if (staticBatch != nullptr)
+        renderer->MarkSpriteDirty(this);
+}
+
 const Sprite *SpriteNode::getSprite() const {
     return static_cast<const Sprite *>(sprite.get());
 }
 
+void SpriteNode::SetSprite(const std::shared_ptr<Sprite> &newSprite) {
+    if (sprite == newSprite)
+        return;
+
+    sprite = newSprite;
+    if (renderer != nullptr && isInRenderer)
+        renderer->MarkSpriteDirty(this);
+}
+
+void SpriteNode::SetPalette(uint8_t newPalette) {
+    if (newPalette >= spriteInstancePaletteCount) {
+        SPDLOG_ERROR("Palette {} does not fit a sprite instance, the last one is {}", static_cast<int>(newPalette),
+                     spriteInstancePaletteCount - 1);
+        return;
+    }
+    if (palette == newPalette)
+        return;
+
+    palette = newPalette;
+    if (renderer != nullptr && isInRenderer)
+        renderer->MarkSpriteDirty(this);
+}
+
+uint8_t SpriteNode::GetPalette() const {
+    return palette;
+}
+
+void SpriteNode::ApplyRenderLayer(uint8_t layer) {
+    bool hasChanged = layer != GetRenderLayer();
+    Node::ApplyRenderLayer(layer);
+
+    // The layer is stored next to the tile index, so it is uploaded like a sprite change.
+    if (hasChanged && renderer != nullptr && isInRenderer)
+        renderer->MarkSpriteDirty(this);
+}
+
+void SpriteNode::SetIsStatic(bool isStatic) {
+    isStaticHint = isStatic;
+}
+
 std::shared_ptr<Node> SpriteNode::Clone() const {
-    std::shared_ptr<SpriteNode> result(new SpriteNode(*Node::Clone()));
+    std::shared_ptr<SpriteNode> result(new SpriteNode());
 
     result->sprite = this->sprite;
     result->renderer = this->renderer;
+    result->isStaticHint = this->isStaticHint;
+    result->palette = this->palette;
+    CloneInto(*result);
     result->renderer->AddNode(result.get());
+    result->isInRenderer = true;
 
     return result;
 }
 
-SpriteNode::SpriteNode(const Node &obj) : Node(obj) {
+SpriteNode::SpriteNode() : Node() {
     sprite = nullptr;
     renderer = nullptr;
+    rendererIndex = 0;
+    isInRenderer = false;
+    gridBounds = {};
+    gridCell = SpriteGrid::noCell;
+    gridIndex = 0;
+    palette = 0;
+    cleanFrames = 0;
+    needsMatrixInstance = false;
+    isStaticHint = false;
+    hasSpriteChangedWhileStatic = false;
+    staticBatch = nullptr;
+    staticChunk = 0;
+    staticIndex = 0;
 }
 
 
@@ -1,4 +1,5 @@
 #include "Nodes/TimerNode.h"
+#include "MainEngine.h"
 
 bool TimerNode::IsOneShoot() const {
     return isOneShoot;
@@ -32,17 +33,25 @@ void TimerNode::SetWaitTime(float waitTime) {
 }
 
 TimerNode::TimerNode(float waitTime)
-        : isOneShoot(true), isPaused(true), waitTime(waitTime), timeLeft(waitTime) {
+        : isOneShoot(true), isPaused(true), waitTime(waitTime), timeLeft(waitTime), scheduler(nullptr) {
 }
 
-TimerNode::TimerNode(Node* obj)
-        : isOneShoot(true), isPaused(true), waitTime(0), timeLeft(0) {
+TimerNode::~TimerNode() {
+    if (scheduler != nullptr)
+        scheduler->Unregister<&TimerNode::UpdateTimer>(UpdatePhase::Gameplay, this);
+}
 
+void TimerNode::OnStart(struct MainEngine* engine) {
+    scheduler = &engine->GetUpdateScheduler();
+    scheduler->Register<&TimerNode::UpdateTimer>(UpdatePhase::Gameplay, this);
 }
 
-void TimerNode::Update(struct MainEngine* engine, float seconds, float deltaSeconds) {
-    Node::Update(engine, seconds, deltaSeconds);
+void TimerNode::OnStop(struct MainEngine* engine) {
+    scheduler->Unregister<&TimerNode::UpdateTimer>(UpdatePhase::Gameplay, this);
+    scheduler = nullptr;
+}
 
+void TimerNode::UpdateTimer(struct MainEngine* engine, float seconds, float deltaSeconds) {
     if (isPaused)
         return;
 
@@ -62,11 +71,11 @@ void TimerNode::Update(struct MainEngine* engine, float seconds, float deltaSeco
 }
 
 std::shared_ptr<Node> TimerNode::Clone() const {
-    std::shared_ptr<TimerNode> result(new TimerNode(Node::Clone().get()));
+    auto result = std::make_shared<TimerNode>(waitTime);
     result->isOneShoot = isOneShoot;
     result->isPaused = isPaused;
     result->timeLeft = timeLeft;
-    result->waitTime = waitTime;
+    CloneInto(*result);
     return result;
 }
 
@@ -0,0 +1,76 @@
+#include "Palette.h"
+
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+
+#include "LoggingMacros.h"
+
+Palette::Palette() : colors(1, Color{0, 0, 0, 0}) {}
+
+bool Palette::LoadFromFile(const std::string &path) {
+    std::ifstream file(path);
+    if (!file) {
+        SPDLOG_ERROR("Failed to open palette: {}", path);
+        return false;
+    }
+
+    colors.resize(1);
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] != '#')
+            continue;
+
+        char* digitsEnd;
+        auto value = static_cast<uint32_t>(std::strtoul(line.c_str() + 1, &digitsEnd, 16));
+        auto digitCount = digitsEnd - (line.c_str() + 1);
+        if (digitCount != 6 && digitCount != 8)
+            continue;
+
+        bool hasAlpha = digitCount == 8;
+        Color color;
+        color[0] = static_cast<uint8_t>(value >> (hasAlpha ? 24 : 16));
+        color[1] = static_cast<uint8_t>(value >> (hasAlpha ? 16 : 8));
+        color[2] = static_cast<uint8_t>(value >> (hasAlpha ? 8 : 0));
+        color[3] = hasAlpha ? static_cast<uint8_t>(value) : 255;
+        if (!AddColor(color))
+            return false;
+    }
+
+    return colors.size() > 1;
+}
+
+bool Palette::AddColor(Color color) {
+    if (colors.size() >= maxColors) {
+        SPDLOG_ERROR("Palette is full, {} colours at most", maxColors);
+        return false;
+    }
+
+    colors.push_back(color);
+    return true;
+}
+
+uint8_t Palette::FindClosest(const uint8_t *rgba) const {
+    if (rgba[3] < 128)
+        return 0;
+
+    size_t closest = 0;
+    int closestDistance = INT_MAX;
+    for (size_t i = 1; i < colors.size(); i++) {
+        int distance = 0;
+        for (size_t channel = 0; channel < 3; channel++) {
+            int difference = static_cast<int>(rgba[channel]) - colors[i][channel];
+            distance += difference * difference;
+        }
+
+        if (distance < closestDistance) {
+            closest = i;
+            closestDistance = distance;
+        }
+    }
+    return static_cast<uint8_t>(closest);
+}
+
+const std::vector<Palette::Color>& Palette::GetColors() const {
+    return colors;
+}
@@ -0,0 +1,109 @@
+#include "RenderThread.h"
+
+#include <chrono>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <imgui_impl/imgui_impl_opengl3.h>
+
+#include "SpriteRenderer.h"
+
+RenderSnapshot::~RenderSnapshot() {
+    for (ImDrawList* drawList : uiDrawLists)
+        IM_DELETE(drawList);
+}
+
+void RenderSnapshot::SetUiDrawData(const ImDrawData &drawData) {
+    for (ImDrawList* drawList : uiDrawLists)
+        IM_DELETE(drawList);
+    uiDrawLists.clear();
+
+    for (int i = 0; i < drawData.CmdListsCount; i++)
+        uiDrawLists.push_back(drawData.CmdLists[i]->CloneOutput());
+    uiDrawData = drawData;
+    uiDrawData.CmdLists = uiDrawLists.data();
+}
+
+RenderThread::RenderThread(GLFWwindow *window, SpriteRenderer &renderer, uint32_t submitCount)
+        : window(window), renderer(renderer), submitCount(submitCount), snapshots(), writeIndex(0), pendingIndex(-1),
+          drawingIndex(-1), isStopping(false), statistics(), thread(&RenderThread::Run, this) {
+}
+
+RenderThread::~RenderThread() {
+    {
+        std::lock_guard lock(mutex);
+        isStopping = true;
+    }
+    condition.notify_all();
+    thread.join();
+}
+
+RenderSnapshot &RenderThread::BeginFrame() {
+    auto waitStartTimePoint = std::chrono::high_resolution_clock::now();
+
+    std::unique_lock lock(mutex);
+    condition.wait(lock, [this] {
+        return pendingIndex == -1 && drawingIndex != static_cast<int32_t>(writeIndex);
+    });
+
+    std::chrono::duration<float, std::milli> waitDuration = std::chrono::high_resolution_clock::now() - waitStartTimePoint;
+    statistics.waitMilliseconds = waitDuration.count();
+    return snapshots[writeIndex];
+}
+
+void RenderThread::EndFrame() {
+    {
+        std::lock_guard lock(mutex);
+        pendingIndex = static_cast<int32_t>(writeIndex);
+        writeIndex = (writeIndex + 1) % snapshots.size();
+    }
+    condition.notify_all();
+}
+
+RenderThreadStatistics RenderThread::GetStatistics() const {
+    std::lock_guard lock(mutex);
+    return statistics;
+}
+
+void RenderThread::DrawSnapshot(GLFWwindow *window, SpriteRenderer &renderer, RenderSnapshot &snapshot,
+                                uint32_t submitCount) {
+    glViewport(0, 0, snapshot.framebufferSize.x, snapshot.framebufferSize.y);
+    // Submitting a frame again writes the same bytes, each repeat clears first so the image stays the same.
+    for (uint32_t i = 0; i < submitCount; i++) {
+        glClearDepth(1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        renderer.Submit(snapshot.sprites);
+    }
+
+    if (snapshot.uiDrawData.Valid)
+        ImGui_ImplOpenGL3_RenderDrawData(&snapshot.uiDrawData);
+    glfwSwapBuffers(window);
+}
+
+void RenderThread::Run() {
+    glfwMakeContextCurrent(window);
+
+    std::unique_lock lock(mutex);
+    while (true) {
+        condition.wait(lock, [this] {
+            return pendingIndex != -1 || isStopping;
+        });
+        if (pendingIndex == -1)
+            break;
+
+        drawingIndex = pendingIndex;
+        pendingIndex = -1;
+        lock.unlock();
+        condition.notify_all();
+
+        auto drawStartTimePoint = std::chrono::high_resolution_clock::now();
+        DrawSnapshot(window, renderer, snapshots[drawingIndex], submitCount);
+        std::chrono::duration<float, std::milli> drawDuration = std::chrono::high_resolution_clock::now() - drawStartTimePoint;
+
+        lock.lock();
+        statistics.drawMilliseconds = drawDuration.count();
+        drawingIndex = -1;
+        condition.notify_all();
+    }
+
+    glfwMakeContextCurrent(nullptr);
+}
@@ -0,0 +1,74 @@
+#include "SceneEditQueue.h"
+
+#include "MainEngine.h"
+#include "Nodes/Node.h"
+#include "LoggingMacros.h"
+
+void SceneEditQueue::QueueAddChild(Node* parent, std::shared_ptr<Node> child) {
+    edits.push_back({EditType::AddChild, parent, child.get(), std::move(child)});
+}
+
+void SceneEditQueue::QueueRemove(Node* node) {
+    edits.push_back({EditType::Remove, nullptr, node, nullptr});
+}
+
+void SceneEditQueue::QueueReparent(Node* node, Node* newParent) {
+    edits.push_back({EditType::Reparent, newParent, node, nullptr});
+}
+
+void SceneEditQueue::Apply(MainEngine* engine) {
+    if (edits.empty())
+        return;
+
+    for (Edit& edit : edits) {
+        switch (edit.type) {
+            case EditType::AddChild:
+                edit.parent->AddChild(edit.newNode);
+                addedNodes.push_back(std::move(edit.newNode));
+                break;
+            case EditType::Remove:
+                if (edit.node->GetParent() != nullptr)
+                    removedNodes.push_back(edit.node->GetParent()->RemoveChild(edit.node));
+                break;
+            case EditType::Reparent:
+                if (edit.node->GetParent() == nullptr) {
+                    SPDLOG_ERROR("Cannot reparent a node that has no parent, add it instead");
+                    break;
+                }
+                if (IsInSubtree(edit.parent, edit.node)) {
+                    SPDLOG_ERROR("Cannot reparent a node under itself or one of its descendants");
+                    break;
+                }
+                edit.parent->AddChild(edit.node->GetParent()->RemoveChild(edit.node));
+                break;
+        }
+    }
+    edits.clear();
+
+    // Removed subtrees leave the scheduler and the renderer in one pass, whether they are destroyed below or kept
+    // elsewhere to be added again. Subtrees that were added back in the same batch keep running.
+    for (const std::shared_ptr<Node>& node : removedNodes) {
+        if (node->GetParent() == nullptr)
+            node->Stop(engine);
+    }
+    removedNodes.clear();
+    engine->GetUpdateScheduler().Compact();
+
+    for (const std::shared_ptr<Node>& node : addedNodes) {
+        if (node->GetParent() != nullptr)
+            node->Start(engine);
+    }
+    addedNodes.clear();
+}
+
+bool SceneEditQueue::IsInSubtree(const Node* node, const Node* subtreeRoot) {
+    for (const Node* ancestor = node; ancestor != nullptr; ancestor = ancestor->GetParent()) {
+        if (ancestor == subtreeRoot)
+            return true;
+    }
+    return false;
+}
+
+bool SceneEditQueue::IsEmpty() const {
+    return edits.empty();
+}
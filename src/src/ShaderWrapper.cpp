@@ -1,50 +1,186 @@
 #include "ShaderWrapper.h"
 
+#include <algorithm>
+#include <bit>
 #include <fstream>
 #include <glad/glad.h>
 #include <spdlog/spdlog.h>
 #include <glm/ext.hpp>
 #include <utility>
 
-void ShaderWrapper::SetFloat(const std::string& Name, float Value) const
+#include "GlStateCache.h"
+
+void ShaderWrapper::SetFloat(UniformName Name, float Value) const
 {
     GLint UniformLocation = GetUniformLocation(Name);
+    if (IsUniformUnchanged(UniformLocation, &Value, sizeof(Value)))
+    {
+        return;
+    }
     glUniform1f(UniformLocation, Value);
 }
 
-void ShaderWrapper::SetInt(const std::string& Name, int Value) const
+void ShaderWrapper::SetInt(UniformName Name, int Value) const
 {
     GLint UniformLocation = GetUniformLocation(Name);
+    if (IsUniformUnchanged(UniformLocation, &Value, sizeof(Value)))
+    {
+        return;
+    }
     glUniform1i(UniformLocation, Value);
 }
 
-void ShaderWrapper::SetBool(const std::string& Name, bool Value) const
+void ShaderWrapper::SetUInt(UniformName Name, GLuint Value) const
 {
     GLint UniformLocation = GetUniformLocation(Name);
+    if (IsUniformUnchanged(UniformLocation, &Value, sizeof(Value)))
+    {
+        return;
+    }
+    glUniform1ui(UniformLocation, Value);
+}
+
+void ShaderWrapper::SetBool(UniformName Name, bool Value) const
+{
+    GLint UniformLocation = GetUniformLocation(Name);
+    if (IsUniformUnchanged(UniformLocation, &Value, sizeof(Value)))
+    {
+        return;
+    }
     glUniform1i(UniformLocation, static_cast<GLint>(Value));
 }
 
-void ShaderWrapper::SetVec4F(const std::string& Name, glm::vec4 Value) const
+void ShaderWrapper::SetVec4F(UniformName Name, glm::vec4 Value) const
 {
     GLint UniformLocation = GetUniformLocation(Name);
+    if (IsUniformUnchanged(UniformLocation, &Value, sizeof(Value)))
+    {
+        return;
+    }
     glUniform4f(UniformLocation, Value.x, Value.y, Value.z, Value.w);
 }
 
-void ShaderWrapper::SetMat4F(const std::string& Name, glm::mat4 Value) const
+void ShaderWrapper::SetIVec2(UniformName Name, glm::ivec2 Value) const
 {
     GLint UniformLocation = GetUniformLocation(Name);
+    if (IsUniformUnchanged(UniformLocation, &Value, sizeof(Value)))
+    {
+        return;
+    }
+    glUniform2i(UniformLocation, Value.x, Value.y);
+}
+
+void ShaderWrapper::SetMat4F(UniformName Name, glm::mat4 Value) const
+{
+    GLint UniformLocation = GetUniformLocation(Name);
+    if (IsUniformUnchanged(UniformLocation, &Value, sizeof(Value)))
+    {
+        return;
+    }
     glUniformMatrix4fv(UniformLocation, 1, GL_FALSE, glm::value_ptr(Value));
 }
 
-GLint ShaderWrapper::GetUniformLocation(const std::string& Name) const
+GLint ShaderWrapper::GetUniformLocation(UniformName Name) const
 {
-    GLint UniformLocation = glGetUniformLocation(ShaderProgramID, Name.c_str());
-    if (UniformLocation == -1)
+    for (uint64_t Index = Name.Hash & UniformTableMask;; Index = (Index + 1) & UniformTableMask)
+    {
+        const UniformSlot& Slot = UniformTable[Index];
+        if (Slot.Location == -1)
+        {
+            spdlog::warn(std::string(Name.Name) + " not found");
+            return -1;
+        }
+        if (Slot.Hash == Name.Hash)
+        {
+            return Slot.Location;
+        }
+    }
+}
+
+bool ShaderWrapper::HasUniformBlock(UniformName Name, GLuint Binding, GLsizeiptr Size) const
+{
+    for (const ReflectedBlock& Block : UniformBlocks)
     {
-        spdlog::warn(Name + " not found");
+        if (Block.Hash != Name.Hash)
+        {
+            continue;
+        }
+        if (Block.Binding != static_cast<GLint>(Binding) || Block.DataSize != Size)
+        {
+            SPDLOG_ERROR(std::string(Name.Name) + " has binding " + std::to_string(Block.Binding) + " and " +
+                         std::to_string(Block.DataSize) + " bytes, expected binding " + std::to_string(Binding) +
+                         " and " + std::to_string(Size) + " bytes");
+            return false;
+        }
+        return true;
     }
 
-    return UniformLocation;
+    SPDLOG_ERROR(std::string(Name.Name) + " block not found");
+    return false;
+}
+
+void ShaderWrapper::ReflectProgram()
+{
+    GLint UniformCount = 0;
+    GLint MaxNameLength = 0;
+    glGetProgramInterfaceiv(ShaderProgramID, GL_UNIFORM, GL_ACTIVE_RESOURCES, &UniformCount);
+    glGetProgramInterfaceiv(ShaderProgramID, GL_UNIFORM, GL_MAX_NAME_LENGTH, &MaxNameLength);
+    std::string Name(std::max(MaxNameLength, 1), '\0');
+
+    std::vector<UniformSlot> Uniforms;
+    for (GLint Index = 0; Index < UniformCount; Index++)
+    {
+        // Uniforms inside blocks have no location.
+        const GLenum LocationProperty = GL_LOCATION;
+        GLint Location = -1;
+        glGetProgramResourceiv(ShaderProgramID, GL_UNIFORM, Index, 1, &LocationProperty, 1, nullptr, &Location);
+        if (Location == -1)
+        {
+            continue;
+        }
+
+        GLsizei NameLength = 0;
+        glGetProgramResourceName(ShaderProgramID, GL_UNIFORM, Index, MaxNameLength, &NameLength, Name.data());
+        std::string_view ReflectedName(Name.data(), NameLength);
+        if (ReflectedName.ends_with("[0]"))
+        {
+            ReflectedName.remove_suffix(3);
+        }
+        Uniforms.push_back({HashUniformName(ReflectedName), Location});
+    }
+
+    UniformTable.assign(std::bit_ceil(Uniforms.size() * 2 + 1), UniformSlot());
+    UniformTableMask = UniformTable.size() - 1;
+    for (const UniformSlot& Uniform : Uniforms)
+    {
+        uint64_t Index = Uniform.Hash & UniformTableMask;
+        while (UniformTable[Index].Location != -1)
+        {
+            if (UniformTable[Index].Hash == Uniform.Hash)
+            {
+                SPDLOG_ERROR("Uniform name hash collision in program " + std::to_string(ShaderProgramID));
+            }
+            Index = (Index + 1) & UniformTableMask;
+        }
+        UniformTable[Index] = Uniform;
+    }
+
+    GLint BlockCount = 0;
+    glGetProgramInterfaceiv(ShaderProgramID, GL_UNIFORM_BLOCK, GL_ACTIVE_RESOURCES, &BlockCount);
+    glGetProgramInterfaceiv(ShaderProgramID, GL_UNIFORM_BLOCK, GL_MAX_NAME_LENGTH, &MaxNameLength);
+    Name.assign(std::max(MaxNameLength, 1), '\0');
+
+    UniformBlocks.clear();
+    for (GLint Index = 0; Index < BlockCount; Index++)
+    {
+        const GLenum BlockProperties[] = {GL_BUFFER_BINDING, GL_BUFFER_DATA_SIZE};
+        GLint Values[2] = {};
+        glGetProgramResourceiv(ShaderProgramID, GL_UNIFORM_BLOCK, Index, 2, BlockProperties, 2, nullptr, Values);
+
+        GLsizei NameLength = 0;
+        glGetProgramResourceName(ShaderProgramID, GL_UNIFORM_BLOCK, Index, MaxNameLength, &NameLength, Name.data());
+        UniformBlocks.push_back({HashUniformName(std::string_view(Name.data(), NameLength)), Values[0], Values[1]});
+    }
 }
 
 GLuint ShaderWrapper::GetShaderProgramId() const
@@ -52,8 +188,24 @@ GLuint ShaderWrapper::GetShaderProgramId() const
     return ShaderProgramID;
 }
 
+bool ShaderWrapper::IsUniformUnchanged(GLint UniformLocation, const void* Value, size_t Size) const
+{
+    return StateCache != nullptr && StateCache->IsUniformUnchanged(ShaderProgramID, UniformLocation, Value, Size);
+}
+
+void ShaderWrapper::SetStateCache(GlStateCache* NewStateCache)
+{
+    StateCache = NewStateCache;
+}
+
 void ShaderWrapper::Activate() const
 {
+    if (StateCache != nullptr)
+    {
+        StateCache->UseProgram(ShaderProgramID);
+        return;
+    }
+
     glUseProgram(ShaderProgramID);
 }
 
@@ -106,6 +258,12 @@ ShaderWrapper::ShaderWrapper(std::string VertexShaderPath, std::string FragmentS
 
 }
 
+ShaderWrapper::ShaderWrapper(std::string ComputeShaderPath)
+{
+    GLuint ComputeShader = CompileComputeShader(ComputeShaderPath);
+    LinkProgram(ComputeShader);
+    glDeleteShader(ComputeShader);
+}
 
 void ShaderWrapper::LinkProgram(GLuint VertexShader, GLuint FragmentShader, GLuint GeometryShader = 0)
 {
@@ -119,7 +277,21 @@ void ShaderWrapper::LinkProgram(GLuint VertexShader, GLuint FragmentShader, GLui
     }
 
     glLinkProgram(ShaderProgramID);
+    LogLinkError();
+    ReflectProgram();
+}
+
+void ShaderWrapper::LinkProgram(GLuint ComputeShader)
+{
+    ShaderProgramID = glCreateProgram();
+    glAttachShader(ShaderProgramID, ComputeShader);
+    glLinkProgram(ShaderProgramID);
+    LogLinkError();
+    ReflectProgram();
+}
 
+void ShaderWrapper::LogLinkError()
+{
     GLint ProgramLinkingResult;
     glGetProgramiv(ShaderProgramID, GL_LINK_STATUS, &ProgramLinkingResult);
     if (!ProgramLinkingResult)
@@ -163,6 +335,17 @@ GLuint ShaderWrapper::CompileGeometryShader(std::string& GeometryShaderPath)
     return GeometryShader;
 }
 
+GLuint ShaderWrapper::CompileComputeShader(std::string& ComputeShaderPath)
+{
+    GLuint ComputeShader;
+    ComputeShader = glCreateShader(GL_COMPUTE_SHADER);
+
+    CompileShader(ComputeShaderPath, ComputeShader);
+    LogShaderError(ComputeShader, "Compute Shader compilation failed: ");
+
+    return ComputeShader;
+}
+
 void ShaderWrapper::LogShaderError(GLuint GeometryShader, const std::string& Message)
 {
     GLint ShaderCompilationResult;
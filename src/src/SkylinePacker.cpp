@@ -0,0 +1,88 @@
+#include "SkylinePacker.h"
+
+#include <algorithm>
+#include <climits>
+
+SkylinePacker::SkylinePacker(glm::ivec2 size) : size(size) {
+    Clear();
+}
+
+std::optional<glm::ivec2> SkylinePacker::Insert(glm::ivec2 rectSize) {
+    if (rectSize.x <= 0 || rectSize.y <= 0)
+        return std::nullopt;
+
+    size_t bestSegment = skyline.size();
+    int bestTop = INT_MAX;
+    int bestWidth = INT_MAX;
+    for (size_t i = 0; i < skyline.size(); i++) {
+        int y = GetRestingHeight(i, rectSize);
+        if (y < 0)
+            continue;
+
+        // Ties go to the narrower segment, which leaves the wide ones for wide rectangles.
+        int top = y + rectSize.y;
+        if (top < bestTop || (top == bestTop && skyline[i].width < bestWidth)) {
+            bestSegment = i;
+            bestTop = top;
+            bestWidth = skyline[i].width;
+        }
+    }
+
+    if (bestSegment == skyline.size())
+        return std::nullopt;
+
+    glm::ivec2 position(skyline[bestSegment].x, bestTop - rectSize.y);
+    skyline.insert(skyline.begin() + static_cast<std::ptrdiff_t>(bestSegment), {position.x, bestTop, rectSize.x});
+
+    // Cuts the segments the new one covers.
+    size_t next = bestSegment + 1;
+    while (next < skyline.size()) {
+        int coveredWidth = position.x + rectSize.x - skyline[next].x;
+        if (coveredWidth <= 0)
+            break;
+
+        if (coveredWidth < skyline[next].width) {
+            skyline[next].x += coveredWidth;
+            skyline[next].width -= coveredWidth;
+            break;
+        }
+        skyline.erase(skyline.begin() + static_cast<std::ptrdiff_t>(next));
+    }
+
+    // Neighbours of equal height become one segment.
+    for (size_t i = 1; i < skyline.size();) {
+        if (skyline[i - 1].y == skyline[i].y) {
+            skyline[i - 1].width += skyline[i].width;
+            skyline.erase(skyline.begin() + static_cast<std::ptrdiff_t>(i));
+        } else {
+            i++;
+        }
+    }
+
+    return position;
+}
+
+void SkylinePacker::Clear() {
+    skyline.clear();
+    skyline.push_back({0, 0, size.x});
+}
+
+glm::ivec2 SkylinePacker::GetSize() const {
+    return size;
+}
+
+int SkylinePacker::GetRestingHeight(size_t segment, glm::ivec2 rectSize) const {
+    if (skyline[segment].x + rectSize.x > size.x)
+        return -1;
+
+    // The segments cover the whole width, so the rectangle always ends on one of them.
+    int y = 0;
+    int remainingWidth = rectSize.x;
+    for (size_t i = segment; remainingWidth > 0; i++) {
+        y = std::max(y, skyline[i].y);
+        if (y + rectSize.y > size.y)
+            return -1;
+        remainingWidth -= skyline[i].width;
+    }
+    return y;
+}
@@ -1,7 +1,12 @@
 #include "Sprite.h"
 
-Sprite::Sprite(const glm::vec<2, int> &tileMapPosition) : TileMapPosition(tileMapPosition) {}
+Sprite::Sprite(const glm::vec<2, int> &tileMapPosition, uint16_t material)
+        : TileMapPosition(tileMapPosition), Material(material) {}
 
 const glm::vec<2, int> &Sprite::GetTileMapPosition() const {
     return TileMapPosition;
 }
+
+uint16_t Sprite::GetMaterial() const {
+    return Material;
+}
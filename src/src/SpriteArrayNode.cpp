@@ -1,5 +1,6 @@
 #include "Nodes/SpriteArrayNode.h"
 #include "SpriteRenderer.h"
+#include "MainEngine.h"
 
 SpriteArrayNode::SpriteArrayNode(const std::vector<std::shared_ptr<Sprite>>& spriteArray, SpriteRenderer* renderer)
 : SpriteNode(spriteArray[0], renderer), currentAnimation() {
@@ -7,6 +8,26 @@ SpriteArrayNode::SpriteArrayNode(const std::vector<std::shared_ptr<Sprite>>& spr
     timeFromLastFrame = 0;
     timeBetweenFrames = 0;
     currentFrame = 0;
+    scheduler = nullptr;
+}
+
+SpriteArrayNode::~SpriteArrayNode() {
+    if (scheduler != nullptr)
+        scheduler->Unregister<&SpriteArrayNode::UpdateAnimation>(UpdatePhase::Animation, this);
+}
+
+void SpriteArrayNode::OnStart(struct MainEngine* engine) {
+    scheduler = &engine->GetUpdateScheduler();
+    scheduler->Register<&SpriteArrayNode::UpdateAnimation>(UpdatePhase::Animation, this);
+
+    SpriteNode::OnStart(engine);
+}
+
+void SpriteArrayNode::OnStop(struct MainEngine* engine) {
+    scheduler->Unregister<&SpriteArrayNode::UpdateAnimation>(UpdatePhase::Animation, this);
+    scheduler = nullptr;
+
+    SpriteNode::OnStop(engine);
 }
 
 void SpriteArrayNode::PlayAnimation(const std::vector<int>& animation, float timeBetweenFrames, bool loop) {
@@ -21,20 +42,14 @@ std::shared_ptr<Node> SpriteArrayNode::Clone() const {
     return nullptr;
 }
 
-void SpriteArrayNode::Update(struct MainEngine* engine, float seconds, float deltaSeconds) {
+void SpriteArrayNode::UpdateAnimation(struct MainEngine* engine, float seconds, float deltaSeconds) {
     timeFromLastFrame += deltaSeconds;
 
     if (timeFromLastFrame < timeBetweenFrames)
-    {
-        Node::Update(engine, seconds, deltaSeconds);
         return;
-    }
 
     if (currentAnimation.empty())
-    {
-        Node::Update(engine, seconds, deltaSeconds);
         return;
-    }
 
 
     if (currentFrame >= spriteArray.size()) {
@@ -46,9 +61,7 @@ void SpriteArrayNode::Update(struct MainEngine* engine, float seconds, float del
     }
 
     int spriteIndex = currentAnimation[currentFrame];
-    sprite = spriteArray[spriteIndex];
+    SetSprite(spriteArray[spriteIndex]);
     timeFromLastFrame = 0.f;
     currentFrame++;
-
-    Node::Update(engine, seconds, deltaSeconds);
 }
@@ -0,0 +1,62 @@
+#include "SpriteGrid.h"
+
+#include <algorithm>
+
+namespace {
+    // Cell coordinates are clamped to 31 bits each so a packed key never collides with the sentinel values.
+    constexpr float cellCoordinateLimit = float(1 << 30);
+}
+
+SpriteGrid::SpriteGrid(float cellSize) : cellSize(cellSize) {}
+
+void SpriteGrid::Update(SpriteNode *node, const Bounds2D &bounds) {
+    node->gridBounds = bounds;
+
+    glm::vec2 size = bounds.max - bounds.min;
+    uint64_t cell = largeCell;
+    if (size.x <= cellSize && size.y <= cellSize) {
+        glm::vec2 center = (bounds.min + bounds.max) * 0.5f;
+        cell = GetCellKey(GetCellCoordinate(center.x), GetCellCoordinate(center.y));
+    }
+
+    if (cell == node->gridCell)
+        return;
+
+    Remove(node);
+
+    std::vector<SpriteNode*>& cellNodes = GetCellNodes(cell);
+    node->gridCell = cell;
+    node->gridIndex = static_cast<uint32_t>(cellNodes.size());
+    cellNodes.push_back(node);
+}
+
+void SpriteGrid::Remove(SpriteNode *node) {
+    if (node->gridCell == noCell)
+        return;
+
+    std::vector<SpriteNode*>& cellNodes = GetCellNodes(node->gridCell);
+    SpriteNode* last = cellNodes.back();
+    cellNodes[node->gridIndex] = last;
+    last->gridIndex = node->gridIndex;
+    cellNodes.pop_back();
+
+    if (cellNodes.empty() && node->gridCell != largeCell)
+        cells.erase(node->gridCell);
+
+    node->gridCell = noCell;
+}
+
+int32_t SpriteGrid::GetCellCoordinate(float position) const {
+    float cell = std::clamp(std::floor(position / cellSize), -cellCoordinateLimit, cellCoordinateLimit - 1.f);
+    return static_cast<int32_t>(cell);
+}
+
+uint64_t SpriteGrid::GetCellKey(int32_t x, int32_t y) {
+    return (uint64_t(x + (1 << 30)) << 31) | uint64_t(y + (1 << 30));
+}
+
+std::vector<SpriteNode *> &SpriteGrid::GetCellNodes(uint64_t cell) {
+    if (cell == largeCell)
+        return largeNodes;
+    return cells[cell];
+}
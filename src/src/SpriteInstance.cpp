@@ -0,0 +1,52 @@
+#include "SpriteInstance.h"
+
+#include <cmath>
+#include <glm/gtc/packing.hpp>
+
+namespace {
+    // Quaternion round trips leave values like sin(pi) behind, which are still meant as zero.
+    constexpr float transformEpsilon = 1e-5f;
+
+    bool IsZero(float value) {
+        return std::abs(value) < transformEpsilon;
+    }
+}
+
+bool PackSpriteTransform(const glm::mat4 &transform, SpriteInstance &instance) {
+    const glm::vec4& xAxis = transform[0];
+    const glm::vec4& yAxis = transform[1];
+
+    if (!IsZero(xAxis.z) || !IsZero(yAxis.z) || !IsZero(xAxis.w) || !IsZero(yAxis.w) || !IsZero(transform[3].w - 1.f))
+        return false;
+
+    float scaleX, scaleY;
+    uint8_t flags = 0;
+    if (IsZero(xAxis.y) && IsZero(yAxis.x)) {
+        scaleX = xAxis.x;
+        scaleY = yAxis.y;
+    } else if (IsZero(xAxis.x) && IsZero(yAxis.y)) {
+        // A quarter turn counter-clockwise maps the x axis onto y and the y axis onto -x.
+        scaleX = xAxis.y;
+        scaleY = -yAxis.x;
+        flags |= SpriteInstanceRotate90;
+    } else {
+        return false;
+    }
+
+    if (scaleX < 0.f)
+        flags |= SpriteInstanceFlipX;
+    if (scaleY < 0.f)
+        flags |= SpriteInstanceFlipY;
+
+    instance.position = glm::vec3(transform[3]);
+    instance.scale[0] = glm::packHalf1x16(std::abs(scaleX));
+    instance.scale[1] = glm::packHalf1x16(std::abs(scaleY));
+    uint8_t paletteBits = instance.flags >> spriteInstancePaletteShift << spriteInstancePaletteShift;
+    instance.flags = paletteBits | flags;
+    return true;
+}
+
+void SetSpriteInstancePalette(SpriteInstance &instance, uint8_t palette) {
+    uint8_t transformFlags = instance.flags & ((1u << spriteInstancePaletteShift) - 1);
+    instance.flags = static_cast<uint8_t>(transformFlags | (palette << spriteInstancePaletteShift));
+}
@@ -1,62 +1,536 @@
 #include "SpriteRenderer.h"
 
 #include <vector>
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
 #include <filesystem>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <random>
 #include <stb_image.h>
+#include <glm/gtc/type_ptr.hpp>
 
 #include "Nodes/SpriteNode.h"
 #include "VAOWrapper.h"
 #include "Sprite.h"
 #include "ShaderWrapper.h"
+#include "InstanceRingBuffer.h"
+#include "FrameAllocator.h"
+#include "SpriteSortKey.h"
+#include "TileLayer.h"
+#include "TileMesh.h"
+#include "StaticSpriteBatch.h"
+#include "TextureAtlas.h"
+#include "Palette.h"
+#include "GpuSpriteCuller.h"
+#include "JobSystem.h"
+#include "GlStateCache.h"
 
 #include "LoggingMacros.h"
 
+namespace {
+    // Above this many changed keys a radix sort beats shifting elements one by one.
+    constexpr uint32_t insertionSortLimit = 16;
 
-SpriteRenderer::SpriteRenderer(std::string tileMapPath, int tileSize)
-        : tileSize(tileSize) {
+    // Most sprites are one unit tiles, a cell holds a small patch of them.
+    constexpr float gridCellSize = 8.f;
 
+    // A sprite that kept its transform and tile this many frames in a row is baked into a static batch.
+    constexpr uint16_t staticFrameThreshold = 60;
 
+    // Sprites with depth writes sort before the blended ones.
+    constexpr uint32_t opaqueSortLayer = 0;
+    constexpr uint32_t translucentSortLayer = 1;
+    constexpr uint64_t translucentKeyBegin = uint64_t(translucentSortLayer)
+                                             << (spriteSortDepthBits + spriteSortMaterialBits + spriteSortIdBits);
+
+    uint16_t GetStaticFrameThreshold(bool isStaticHint) {
+        return isStaticHint ? 1 : staticFrameThreshold;
+    }
+
+    void AppendSlotRange(std::vector<InstanceRange>& ranges, size_t slot, GLsizeiptr elementSize) {
+        auto offset = static_cast<GLintptr>(slot * elementSize);
+        if (!ranges.empty() && ranges.back().offset + ranges.back().size == offset)
+            ranges.back().size += elementSize;
+        else
+            ranges.push_back({offset, elementSize});
+    }
+
+    GLsizeiptr GetRangesSize(const std::vector<InstanceRange>& ranges) {
+        GLsizeiptr size = 0;
+        for (const InstanceRange& range : ranges)
+            size += range.size;
+        return size;
+    }
+
+    // Copies the bytes of every range to destination, back to back.
+    void CopySlotRanges(const void* source, const std::vector<InstanceRange>& ranges, std::byte* destination) {
+        for (const InstanceRange& range : ranges) {
+            std::memcpy(destination, static_cast<const std::byte*>(source) + range.offset,
+                        static_cast<size_t>(range.size));
+            destination += range.size;
+        }
+    }
+
+    // The reverse of CopySlotRanges, on the render side.
+    void ApplySlotRanges(std::vector<std::byte>& target, GLsizeiptr size, const std::vector<InstanceRange>& ranges,
+                         const std::vector<std::byte>& bytes) {
+        target.resize(static_cast<size_t>(size));
+        const std::byte* source = bytes.data();
+        for (const InstanceRange& range : ranges) {
+            std::memcpy(target.data() + range.offset, source, static_cast<size_t>(range.size));
+            source += range.size;
+        }
+    }
+}
+
+SpriteRenderer::SpriteRenderer(std::string tileMapPath, int tileSize, bool useTileArray)
+        : useCompactInstances(true), framesWithoutMatrixInstances(0), nextSortId(0), hasRemovedNodes(false), areSortKeysStale(false),
+          isOpaquePassEnabled(true), isCountingFragments(false), cameraProjection(1.f), cameraView(1.f),
+          jobSystem(nullptr), grid(gridCellSize), viewBounds(), hasViewBounds(false), isCullingEnabled(true), isGpuCullingEnabled(false),
+          nextTileLayerId(1), renderLayerOffsets(), isRenderLayerUsed(), areRenderLayerOffsetsDirty(true), hasPromotionCandidates(false),
+          hasRemovedStaticNodes(false),
+          cameraBuffer(0), submittedProjection(std::numeric_limits<float>::quiet_NaN()),
+          submittedView(std::numeric_limits<float>::quiet_NaN()), renderLayerBuffer(0), fragmentQueries(), isFragmentQueryPending(), fragmentQueryIndex(0),
+          materialBindCount(0), tileMeshQuadCount(0), fragmentCount(0), paletteTexture(0), paletteCount(1),
+          useTileArray(useTileArray) {
+    isRenderLayerUsed[0] = true;
+
+
+    stateCache = std::make_unique<GlStateCache>();
     InitializeVAO();
-    shader = std::make_unique<ShaderWrapper>("res/shaders/tile_map.vert", "res/shaders/tile_map.frag");
-    tileMap = TextureFromFile(tileMapPath);
+    std::string vertexSuffix = useTileArray ? "_array.vert" : ".vert";
+    std::string fragmentSuffix = useTileArray ? "_array.frag" : ".frag";
+    shader = std::make_unique<ShaderWrapper>("res/shaders/tile_map" + vertexSuffix, "res/shaders/tile_map" + fragmentSuffix);
+    compactShader = std::make_unique<ShaderWrapper>("res/shaders/tile_map_compact" + vertexSuffix,
+                                                    "res/shaders/tile_map" + fragmentSuffix);
+    layerShader = std::make_unique<ShaderWrapper>("res/shaders/tile_layer.vert", "res/shaders/tile_layer" + fragmentSuffix);
+    meshShader = std::make_unique<ShaderWrapper>("res/shaders/tile_mesh.vert", "res/shaders/tile_mesh" + fragmentSuffix);
+    culledShader = std::make_unique<ShaderWrapper>("res/shaders/tile_map_culled" + vertexSuffix,
+                                                   "res/shaders/tile_map" + fragmentSuffix);
+    gpuCuller = std::make_unique<GpuSpriteCuller>();
+    for (ShaderWrapper* spriteShader : {shader.get(), compactShader.get(), layerShader.get(), meshShader.get(),
+                                        culledShader.get()}) {
+        spriteShader->SetStateCache(stateCache.get());
+        spriteShader->HasUniformBlock(cameraBlock);
+        spriteShader->HasUniformBlock(renderLayerBlock);
+    }
+
+    std::vector<unsigned char> clearPalettes(Palette::maxColors * maxPalettes * 4, 0);
+    glGenTextures(1, &paletteTexture);
+    glBindTexture(GL_TEXTURE_2D, paletteTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, Palette::maxColors, maxPalettes, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                 clearPalettes.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    // Material 0 exists even if its texture failed to load, every sprite falls back to it.
+    SpriteMaterial& defaultMaterial = materials.emplace_back();
+    defaultMaterial.tileSize = tileSize;
+    TextureFromFile(tileMapPath, defaultMaterial);
+
+    glGenQueries(static_cast<GLsizei>(fragmentQueries.size()), fragmentQueries.data());
 
     glBindVertexArray(0);
 }
 
-GLuint SpriteRenderer::TextureFromFile(const std::string &path) {
-    GLuint textureId;
-    glGenTextures(1, &textureId);
+uint16_t SpriteRenderer::AddMaterial(const std::string &texturePath, int tileSize) {
+    if (materials.size() > spriteSortMaterialMask) {
+        SPDLOG_ERROR("Too many sprite materials, drawing {} with material 0", texturePath);
+        return 0;
+    }
+
+    SpriteMaterial material;
+    material.tileSize = tileSize;
+    if (!TextureFromFile(texturePath, material)) {
+        glDeleteTextures(1, &material.texture);
+        glDeleteBuffers(1, &material.tileRectBuffer);
+        glDeleteBuffers(1, &material.tileOpacityBuffer);
+        return 0;
+    }
+
+    materials.push_back(std::move(material));
+    return static_cast<uint16_t>(materials.size() - 1);
+}
+
+uint16_t SpriteRenderer::AddMaterial(const TextureAtlas &atlas) {
+    if (materials.size() > spriteSortMaterialMask) {
+        SPDLOG_ERROR("Too many sprite materials, drawing the atlas with material 0");
+        return 0;
+    }
+
+    SpriteMaterial& material = materials.emplace_back();
+    if (atlas.IsIndexed()) {
+        material.isIndexed = true;
+        material.palette = AddPalette(*atlas.GetPalette());
+    }
+    UploadAtlas(atlas, material);
+    return static_cast<uint16_t>(materials.size() - 1);
+}
+
+void SpriteRenderer::UpdateMaterial(uint16_t material, const TextureAtlas &atlas) {
+    if (material == 0 || material >= materials.size()) {
+        SPDLOG_ERROR("Material {} is not an atlas material", material);
+        return;
+    }
+
+    SpriteMaterial& updatedMaterial = materials[material];
+    if (updatedMaterial.isIndexed != atlas.IsIndexed()) {
+        SPDLOG_ERROR("Material {} cannot switch between indexed and colour atlases", material);
+        return;
+    }
+    if (updatedMaterial.isIndexed)
+        SetPalette(updatedMaterial.palette, *atlas.GetPalette());
+    UploadAtlas(atlas, updatedMaterial);
+}
+
+uint8_t SpriteRenderer::AddPalette(const Palette &palette) {
+    if (paletteCount >= maxPalettes) {
+        SPDLOG_ERROR("All {} palette rows are taken", maxPalettes - 1);
+        return 0;
+    }
+
+    uint8_t row = paletteCount++;
+    SetPalette(row, palette);
+    return row;
+}
+
+void SpriteRenderer::SetPalette(uint8_t palette, const Palette &colors) {
+    if (palette == 0 || palette >= paletteCount) {
+        SPDLOG_ERROR("Palette {} was not added", palette);
+        return;
+    }
+
+    const std::vector<Palette::Color>& paletteColors = colors.GetColors();
+    glBindTexture(GL_TEXTURE_2D, paletteTexture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, palette, static_cast<GLsizei>(paletteColors.size()), 1, GL_RGBA,
+                    GL_UNSIGNED_BYTE, paletteColors.data());
+}
+
+bool SpriteRenderer::TextureFromFile(const std::string &path, SpriteMaterial &material) {
+    glGenTextures(1, &material.texture);
 
     SPDLOG_DEBUG("Loading texture at path: {}", path);
 
     int width, height, NumberOfComponents;
     auto imageData = stbi_load(path.c_str(), &width, &height, &NumberOfComponents, 0);
-    if (imageData) {
-        GLenum colorFormat;
-        if (NumberOfComponents == 1)
-            colorFormat = (GL_RED);
-        else if (NumberOfComponents == 3)
-            colorFormat = (GL_RGB);
-        else if (NumberOfComponents == 4)
-            colorFormat = (GL_RGBA);
-
-        glBindTexture(GL_TEXTURE_2D, textureId);
+    if (!imageData) {
+        SPDLOG_ERROR("Failed to load texture at path: {}", path);
+        stbi_image_free(imageData);
+        UploadTileBuffers(material);
+        return false;
+    }
+
+    GLenum colorFormat;
+    if (NumberOfComponents == 1)
+        colorFormat = (GL_RED);
+    else if (NumberOfComponents == 3)
+        colorFormat = (GL_RGB);
+    else if (NumberOfComponents == 4)
+        colorFormat = (GL_RGBA);
+
+    material.tilesPerRow = std::max(width / material.tileSize, 1);
+    ClassifyTiles(material, imageData, width, height, NumberOfComponents);
+
+    if (useTileArray) {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, material.texture);
+        UploadTileArray(material, imageData, width, height, NumberOfComponents, colorFormat);
+    } else {
+        glBindTexture(GL_TEXTURE_2D, material.texture);
         glTexImage2D(GL_TEXTURE_2D, 0, colorFormat, width, height, 0, colorFormat, GL_UNSIGNED_BYTE, imageData);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
 
-        tileMapSize = width;
+    // Grid cells in tile index order, tile row 0 is the top of the image.
+    material.tileRects.clear();
+    glm::vec2 uvTileSize = glm::vec2(static_cast<float>(material.tileSize)) / glm::vec2(width, height);
+    for (int tileY = 0; tileY < height / material.tileSize; tileY++) {
+        for (int tileX = 0; tileX < material.tilesPerRow; tileX++) {
+            glm::vec2 min(static_cast<float>(tileX) * uvTileSize.x, 1.f - static_cast<float>(tileY + 1) * uvTileSize.y);
+            glm::vec4 rect = useTileArray ? glm::vec4(0.f, 0.f, 1.f, 1.f) : glm::vec4(min, min + uvTileSize);
+            material.tileRects.push_back(rect);
+        }
+    }
+    UploadTileBuffers(material);
 
-        stbi_image_free(imageData);
-    } else {
-        SPDLOG_ERROR("Failed to load texture at path: {}", path);
-        stbi_image_free(imageData);
+    stbi_image_free(imageData);
+    return true;
+}
+
+void SpriteRenderer::UploadAtlas(const TextureAtlas &atlas, SpriteMaterial &material) {
+    const std::vector<AtlasRegion>& regions = atlas.GetRegions();
+    glm::ivec2 atlasSize = atlas.GetSize();
+    constexpr int componentCount = 4;
+
+    // Indexed atlases keep their colour pixels quantized, so the opacities match what the palette draws.
+    material.tileOpacities.clear();
+    material.hasTranslucentTiles = false;
+    for (const AtlasRegion &region : regions) {
+        TileOpacity opacity = ClassifyRect(atlas.GetPixels(), atlasSize.x, componentCount, region.position,
+                                           region.size);
+        material.tileOpacities.push_back(opacity);
+        material.hasTranslucentTiles |= opacity == TileOpacity::Translucent;
+    }
+
+    // Integer textures cannot be filtered, indexed atlases are sampled with GL_NEAREST and without mipmaps.
+    const unsigned char* texels = material.isIndexed ? atlas.GetIndices() : atlas.GetPixels();
+    int texelBytes = material.isIndexed ? 1 : componentCount;
+    GLenum internalFormat = material.isIndexed ? GL_R8UI : GL_RGBA8;
+    GLenum format = material.isIndexed ? GL_RED_INTEGER : GL_RGBA;
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    material.tileRects.clear();
+    if (!useTileArray) {
+        if (material.texture == 0)
+            glGenTextures(1, &material.texture);
+        glBindTexture(GL_TEXTURE_2D, material.texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(internalFormat), atlasSize.x, atlasSize.y, 0, format,
+                     GL_UNSIGNED_BYTE, texels);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        for (const AtlasRegion &region : regions)
+            material.tileRects.push_back(region.uvRect);
+        UploadTileBuffers(material);
+        return;
+    }
+
+    // Every region gets a layer the size of the largest one. Storage is immutable, a grown atlas needs a new texture.
+    glm::ivec2 layerSize(1);
+    for (const AtlasRegion &region : regions)
+        layerSize = glm::max(layerSize, region.size);
+
+    glDeleteTextures(1, &material.texture);
+    glGenTextures(1, &material.texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, material.texture);
+    auto levelCount = static_cast<GLsizei>(std::bit_width(static_cast<unsigned>(std::max(layerSize.x, layerSize.y))));
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, material.isIndexed ? 1 : levelCount, internalFormat, layerSize.x, layerSize.y,
+                   std::max(static_cast<GLsizei>(regions.size()), 1));
+
+    // Cleared around the region, so mipmaps only blend it with transparent texels.
+    std::vector<unsigned char> layerTexels(static_cast<size_t>(layerSize.x) * layerSize.y * texelBytes);
+    for (size_t i = 0; i < regions.size(); i++) {
+        const AtlasRegion& region = regions[i];
+        std::fill(layerTexels.begin(), layerTexels.end(), 0);
+        size_t rowBytes = static_cast<size_t>(region.size.x) * texelBytes;
+        for (int row = 0; row < region.size.y; row++) {
+            const unsigned char* source = texels + (static_cast<size_t>(region.position.y + row) * atlasSize.x
+                                                    + region.position.x) * texelBytes;
+            std::memcpy(layerTexels.data() + row * static_cast<size_t>(layerSize.x) * texelBytes, source, rowBytes);
+        }
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, static_cast<GLint>(i), layerSize.x, layerSize.y, 1, format,
+                        GL_UNSIGNED_BYTE, layerTexels.data());
+        if (!material.isIndexed) {
+            TileOpacity mipOpacity = UploadMipLevels(layerTexels, layerSize, componentCount, static_cast<GLint>(i),
+                                                     format, material.tileOpacities[i]);
+            material.tileOpacities[i] = std::max(material.tileOpacities[i], mipOpacity);
+            material.hasTranslucentTiles |= mipOpacity == TileOpacity::Translucent;
+        }
+
+        material.tileRects.emplace_back(glm::vec2(0.f), glm::vec2(region.size) / glm::vec2(layerSize));
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER,
+                    material.isIndexed ? GL_NEAREST : GL_LINEAR_MIPMAP_LINEAR);
+
+    UploadTileBuffers(material);
+}
+
+void SpriteRenderer::UploadTileBuffers(SpriteMaterial &material) {
+    // A material without tiles still gets a rect, so its buffer can be bound.
+    if (material.tileRects.empty())
+        material.tileRects.emplace_back(0.f, 0.f, 1.f, 1.f);
+
+    if (material.tileRectBuffer == 0)
+        glGenBuffers(1, &material.tileRectBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, material.tileRectBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(material.tileRects.size() * sizeof(glm::vec4)),
+                 material.tileRects.data(), GL_STATIC_DRAW);
+
+    // One uint per tile, the shaders index it like the rects.
+    std::vector<GLuint> opacities(material.tileOpacities.size());
+    std::transform(material.tileOpacities.begin(), material.tileOpacities.end(), opacities.begin(),
+                   [](TileOpacity opacity) { return static_cast<GLuint>(opacity); });
+    opacities.resize(std::max(opacities.size(), material.tileRects.size()),
+                     static_cast<GLuint>(TileOpacity::Translucent));
+    if (material.tileOpacityBuffer == 0)
+        glGenBuffers(1, &material.tileOpacityBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, material.tileOpacityBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(opacities.size() * sizeof(GLuint)),
+                 opacities.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void SpriteRenderer::ClassifyTiles(SpriteMaterial &material, const unsigned char *pixels, int width, int height,
+                                   int componentCount) {
+    int tileSize = material.tileSize;
+    int columns = material.tilesPerRow;
+    int rows = height / tileSize;
+    material.tileOpacities.assign(columns * rows, TileOpacity::Opaque);
+    material.hasTranslucentTiles = false;
+
+    for (int tileY = 0; tileY < rows; tileY++) {
+        for (int tileX = 0; tileX < columns; tileX++) {
+            // The image is loaded flipped, tile row 0 is at the end of the buffer.
+            glm::ivec2 position(tileX * tileSize, height - (tileY + 1) * tileSize);
+            TileOpacity opacity = ClassifyRect(pixels, width, componentCount, position, glm::ivec2(tileSize));
+            material.tileOpacities[tileY * columns + tileX] = opacity;
+            material.hasTranslucentTiles |= opacity == TileOpacity::Translucent;
+        }
+    }
+}
+
+TileOpacity SpriteRenderer::UploadMipLevels(std::vector<unsigned char> texels, glm::ivec2 size, int componentCount,
+                                            GLint layer, GLenum format, TileOpacity opacity) {
+    // Averaged alpha thins out thin shapes until the half coverage cut of the shaders drops them.
+    float coverage = -1.f;
+    if (componentCount == 4 && opacity != TileOpacity::Translucent) {
+        size_t coveredCount = 0;
+        for (size_t i = 3; i < texels.size(); i += 4)
+            coveredCount += texels[i] >= 128;
+        coverage = static_cast<float>(coveredCount) / static_cast<float>(texels.size() / 4);
     }
 
-    return textureId;
+    opacity = TileOpacity::Opaque;
+    std::vector<unsigned char> levelTexels;
+    for (GLint level = 1; size.x > 1 || size.y > 1; level++) {
+        glm::ivec2 levelSize = glm::max(size / 2, glm::ivec2(1));
+        levelTexels.assign(static_cast<size_t>(levelSize.x) * levelSize.y * componentCount, 0);
+
+        // 2x2 box filter, colours weighted by alpha so the transparent texels around a sprite do not darken its edges.
+        for (int y = 0; y < levelSize.y; y++) {
+            for (int x = 0; x < levelSize.x; x++) {
+                std::array<unsigned, 4> colorSum{};
+                unsigned weightSum = 0;
+                for (int sampleY = 2 * y; sampleY < std::min(2 * y + 2, size.y); sampleY++) {
+                    for (int sampleX = 2 * x; sampleX < std::min(2 * x + 2, size.x); sampleX++) {
+                        const unsigned char* texel = &texels[(static_cast<size_t>(sampleY) * size.x + sampleX)
+                                                             * componentCount];
+                        unsigned weight = componentCount == 4 ? texel[3] : 255;
+                        for (int component = 0; component < std::min(componentCount, 3); component++)
+                            colorSum[component] += texel[component] * weight;
+                        colorSum[3] += weight;
+                        weightSum++;
+                    }
+                }
+
+                unsigned char* levelTexel = &levelTexels[(static_cast<size_t>(y) * levelSize.x + x) * componentCount];
+                for (int component = 0; component < std::min(componentCount, 3) && colorSum[3] > 0; component++)
+                    levelTexel[component] = static_cast<unsigned char>(colorSum[component] / colorSum[3]);
+                if (componentCount == 4)
+                    levelTexel[3] = static_cast<unsigned char>((colorSum[3] + weightSum / 2) / weightSum);
+            }
+        }
+
+        if (coverage >= 0.f)
+            PreserveAlphaCoverage(levelTexels, coverage);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, levelSize.x, levelSize.y, 1, format,
+                        GL_UNSIGNED_BYTE, levelTexels.data());
+        opacity = std::max(opacity, ClassifyRect(levelTexels.data(), levelSize.x, componentCount, glm::ivec2(0),
+                                                 levelSize));
+        texels.swap(levelTexels);
+        size = levelSize;
+    }
+    return opacity;
+}
+
+void SpriteRenderer::PreserveAlphaCoverage(std::vector<unsigned char> &texels, float coverage) {
+    std::vector<unsigned char> alphas;
+    alphas.reserve(texels.size() / 4);
+    for (size_t i = 3; i < texels.size(); i += 4)
+        alphas.push_back(texels[i]);
+
+    // The alpha of the last texel that still fits the coverage becomes the cut, never below 1 so empty texels stay.
+    auto keptCount = static_cast<size_t>(std::lround(coverage * static_cast<float>(alphas.size())));
+    unsigned char threshold = 255;
+    if (keptCount > 0) {
+        std::nth_element(alphas.begin(), alphas.begin() + static_cast<std::ptrdiff_t>(keptCount - 1), alphas.end(),
+                         std::greater<>());
+        threshold = std::max<unsigned char>(alphas[keptCount - 1], 1);
+    }
+
+    for (size_t i = 3; i < texels.size(); i += 4)
+        texels[i] = keptCount > 0 && texels[i] >= threshold ? 255 : 0;
+}
+
+TileOpacity SpriteRenderer::ClassifyRect(const unsigned char *pixels, int width, int componentCount,
+                                         glm::ivec2 position, glm::ivec2 size) {
+    if (componentCount != 4)
+        return TileOpacity::Opaque;
+
+    TileOpacity opacity = TileOpacity::Opaque;
+    for (int y = position.y; y < position.y + size.y; y++) {
+        const unsigned char* row = pixels + static_cast<size_t>(y) * width * componentCount;
+        for (int x = position.x; x < position.x + size.x; x++) {
+            unsigned char alpha = row[x * componentCount + 3];
+            if (alpha != 0 && alpha != 255)
+                return TileOpacity::Translucent;
+            if (alpha == 0)
+                opacity = TileOpacity::AlphaTested;
+        }
+    }
+    return opacity;
+}
+
+void SpriteRenderer::UploadTileArray(SpriteMaterial &material, const unsigned char *pixels, int width, int height,
+                                     int componentCount, GLenum colorFormat) {
+    int tileSize = material.tileSize;
+    int columns = material.tilesPerRow;
+    int rows = std::max(height / tileSize, 1);
+    auto levelCount = static_cast<GLsizei>(std::bit_width(static_cast<unsigned>(tileSize)));
+
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, levelCount, colorFormat == GL_RGBA ? GL_RGBA8 : GL_RGB8, tileSize, tileSize,
+                   columns * rows);
+
+    // Layer index matches GetTileIndex(). The image is loaded flipped, so tile row 0 starts at the end of the buffer.
+    size_t rowBytes = static_cast<size_t>(tileSize) * componentCount;
+    std::vector<unsigned char> tileTexels(rowBytes * tileSize);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (int tileY = 0; tileY < rows; tileY++) {
+        for (int tileX = 0; tileX < columns; tileX++) {
+            for (int row = 0; row < tileSize; row++) {
+                size_t sourceRow = static_cast<size_t>(height - (tileY + 1) * tileSize + row);
+                std::memcpy(tileTexels.data() + row * rowBytes,
+                            pixels + (sourceRow * width + static_cast<size_t>(tileX) * tileSize) * componentCount,
+                            rowBytes);
+            }
+
+            int tileIndex = tileY * columns + tileX;
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, tileIndex, tileSize, tileSize, 1, colorFormat,
+                            GL_UNSIGNED_BYTE, tileTexels.data());
+            if (tileIndex >= static_cast<int>(material.tileOpacities.size()))
+                continue;
+
+            TileOpacity& opacity = material.tileOpacities[tileIndex];
+            TileOpacity mipOpacity = UploadMipLevels(tileTexels, glm::ivec2(tileSize), componentCount, tileIndex,
+                                                     colorFormat, opacity);
+            opacity = std::max(opacity, mipOpacity);
+            material.hasTranslucentTiles |= mipOpacity == TileOpacity::Translucent;
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 }
 
 void SpriteRenderer::InitializeVAO() {
@@ -71,97 +545,1039 @@ void SpriteRenderer::InitializeVAO() {
 
     tileVAO = std::make_unique<VAOWrapper>(vertices, indices);
 
-    glGenBuffers(1, &matrixBuffer);
-    glGenBuffers(1, &textureCordBuffer);
+    matrixBuffer = std::make_unique<InstanceRingBuffer>(1024 * sizeof(glm::mat4));
+    tileBuffer = std::make_unique<InstanceRingBuffer>(1024 * sizeof(glm::ivec2));
 
-    glBindBuffer(GL_ARRAY_BUFFER, matrixBuffer);
     glBindVertexArray(tileVAO->GetVaoId());
 
-    const GLsizei SizeOfVec4 = sizeof(glm::vec4);
+    // Instance attributes use separate buffer bindings, so Draw() can point them at whichever ring buffer region
+    // was written last without re-specifying the attribute layout.
+    const GLuint SizeOfVec4 = sizeof(glm::vec4);
+    for (GLuint column = 0; column < 4; column++) {
+        glEnableVertexAttribArray(1 + column);
+        glVertexAttribFormat(1 + column, 4, GL_FLOAT, GL_FALSE, column * SizeOfVec4);
+        glVertexAttribBinding(1 + column, matrixBindingIndex);
+    }
+    glVertexBindingDivisor(matrixBindingIndex, 1);
+
+    glEnableVertexAttribArray(5);
+    glVertexAttribIFormat(5, 2, GL_INT, 0);
+    glVertexAttribBinding(5, tileBindingIndex);
+    glVertexBindingDivisor(tileBindingIndex, 1);
+
+    compactTileVAO = std::make_unique<VAOWrapper>(vertices, indices);
+    compactInstanceBuffer = std::make_unique<InstanceRingBuffer>(1024 * sizeof(SpriteInstance));
+
+    glBindVertexArray(compactTileVAO->GetVaoId());
+
     glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 4 * SizeOfVec4, (void *) 0);
+    glVertexAttribFormat(1, 3, GL_FLOAT, GL_FALSE, offsetof(SpriteInstance, position));
+    glVertexAttribBinding(1, compactInstanceBindingIndex);
+
     glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, 4 * SizeOfVec4, (void *) (SizeOfVec4));
+    glVertexAttribFormat(2, 2, GL_HALF_FLOAT, GL_FALSE, offsetof(SpriteInstance, scale));
+    glVertexAttribBinding(2, compactInstanceBindingIndex);
+
     glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 4 * SizeOfVec4, (void *) (2 * SizeOfVec4));
+    glVertexAttribIFormat(3, 1, GL_UNSIGNED_SHORT, offsetof(SpriteInstance, tileIndex));
+    glVertexAttribBinding(3, compactInstanceBindingIndex);
+
     glEnableVertexAttribArray(4);
-    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, 4 * SizeOfVec4, (void *) (3 * SizeOfVec4));
+    glVertexAttribIFormat(4, 1, GL_UNSIGNED_BYTE, offsetof(SpriteInstance, flags));
+    glVertexAttribBinding(4, compactInstanceBindingIndex);
+
+    glEnableVertexAttribArray(5);
+    glVertexAttribIFormat(5, 1, GL_UNSIGNED_BYTE, offsetof(SpriteInstance, layer));
+    glVertexAttribBinding(5, compactInstanceBindingIndex);
 
-    glVertexAttribDivisor(1, 1);
-    glVertexAttribDivisor(2, 1);
-    glVertexAttribDivisor(3, 1);
-    glVertexAttribDivisor(4, 1);
+    glVertexBindingDivisor(compactInstanceBindingIndex, 1);
 
-    glBindBuffer(GL_ARRAY_BUFFER, textureCordBuffer);
+    culledTileVAO = std::make_unique<VAOWrapper>(vertices, indices);
 
-    glEnableVertexAttribArray(5);
-    glVertexAttribIPointer(5, 2, GL_INT, sizeof(glm::vec<2, int>), (void *) 0);
-    glVertexAttribDivisor(5, 1);
+    glBindVertexArray(culledTileVAO->GetVaoId());
+
+    glEnableVertexAttribArray(1);
+    glVertexAttribIFormat(1, 1, GL_UNSIGNED_INT, 0);
+    glVertexAttribBinding(1, culledSlotBindingIndex);
+    glVertexBindingDivisor(culledSlotBindingIndex, 1);
+
+    drawCommandBuffer = std::make_unique<InstanceRingBuffer>(256 * sizeof(DrawElementsIndirectCommand));
+
+    layerVAO = std::make_unique<VAOWrapper>(vertices, indices);
+
+    glGenBuffers(1, &cameraBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, cameraBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, cameraBlock.Size, nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, cameraBlock.Binding, cameraBuffer);
+
+    glGenBuffers(1, &renderLayerBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, renderLayerBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, renderLayerBlock.Size, nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, renderLayerBlock.Binding, renderLayerBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
 }
 
 void SpriteRenderer::AddNode(SpriteNode *node) {
+    node->rendererIndex = static_cast<uint32_t>(nodes.size());
     nodes.push_back(node);
+    sortKeys.push_back(MakeNodeSortKey(node, nextSortId++));
 }
 
 void SpriteRenderer::RemoveNode(SpriteNode *node) {
-    auto foundIterator = std::find(nodes.begin(), nodes.end(),node);
-    nodes.erase(foundIterator);
+    if (node->staticBatch != nullptr) {
+        if (node->hasSpriteChangedWhileStatic)
+            std::erase(demotedNodes, node);
+        node->staticBatch->Remove(node);
+        hasRemovedStaticNodes = true;
+        return;
+    }
+
+    // Only clears the slot, every removal of the frame is compacted at once in the next Draw().
+    nodes[node->rendererIndex] = nullptr;
+    if (node->rendererIndex < uploadedNodes.size())
+        uploadedNodes[node->rendererIndex] = nullptr;
+    hasRemovedNodes = true;
+    grid.Remove(node);
+}
+
+void SpriteRenderer::MarkSpriteDirty(SpriteNode *node) {
+    if (node->staticBatch != nullptr) {
+        if (!node->hasSpriteChangedWhileStatic)
+            demotedNodes.push_back(node);
+        node->hasSpriteChangedWhileStatic = true;
+        return;
+    }
+
+    spriteDirtySlots.push_back(node->rendererIndex);
+}
+
+void SpriteRenderer::PromoteStaticNodes() {
+    hasPromotionCandidates = false;
+
+    SpriteInstance instance;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        SpriteNode *node = nodes[i];
+        if (node == nullptr || node->cleanFrames < GetStaticFrameThreshold(node->isStaticHint)
+            || node->WasDirtyThisFrame() || !PackSpriteTransform(*node->GetWorldTransformMatrix(), instance))
+            continue;
+
+        nodes[i] = nullptr;
+        if (node->rendererIndex < uploadedNodes.size())
+            uploadedNodes[node->rendererIndex] = nullptr;
+        hasRemovedNodes = true;
+        grid.Remove(node);
+        node->gridBounds = GetNodeBounds(node);
+
+        float depth = (*node->GetWorldTransformMatrix())[3][2];
+        uint8_t layer = node->GetRenderLayer();
+        uint16_t material = GetNodeMaterial(node);
+        uint64_t batchKey = (uint64_t(material) << 32) | (uint64_t(layer) << spriteSortDepthBits)
+                            | SpriteSortDepth(depth);
+        std::unique_ptr<StaticSpriteBatch>& batch = staticBatches[batchKey];
+        if (!batch)
+            batch = std::make_unique<StaticSpriteBatch>(depth, layer, material);
+        batch->Add(node);
+    }
+}
+
+void SpriteRenderer::DemoteStaticNodes(SpriteFrame &frame) {
+    for (SpriteNode *node : demotedNodes) {
+        node->staticBatch->Remove(node);
+        node->hasSpriteChangedWhileStatic = false;
+        node->cleanFrames = 0;
+        AddNode(node);
+    }
+    demotedNodes.clear();
+    hasRemovedStaticNodes = false;
+
+    std::erase_if(staticBatches, [&frame](const auto& entry) {
+        if (!entry.second->IsEmpty())
+            return false;
+
+        frame.removedStaticBatches.push_back(entry.first);
+        return true;
+    });
+}
+
+void SpriteRenderer::CompactNodes() {
+    size_t keptCount = 0;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        if (nodes[i] == nullptr)
+            continue;
+
+        nodes[keptCount] = nodes[i];
+        sortKeys[keptCount] = sortKeys[i];
+        keptCount++;
+    }
+    nodes.resize(keptCount);
+    sortKeys.resize(keptCount);
+    hasRemovedNodes = false;
+}
+
+uint64_t SpriteRenderer::MakeNodeSortKey(const SpriteNode *node, uint32_t id) const {
+    float depth = (*node->GetWorldTransformMatrix())[3][2];
+    uint16_t material = GetNodeMaterial(node);
+    if (!isOpaquePassEnabled || GetTileOpacity(GetTileIndex(node), material) == TileOpacity::Translucent)
+        return MakeSpriteSortKey(translucentSortLayer, depth, material, id);
+
+    // Negating the depth sorts the opaque sprites front to back. The depth test makes their order across materials
+    // irrelevant, so each material is kept in one run.
+    return MakeMaterialFirstSortKey(opaqueSortLayer, -depth, material, id);
+}
+
+uint32_t SpriteRenderer::UpdateSortKeys() {
+    // A new sprite can move a node between the opaque and the translucent part.
+    std::sort(spriteDirtySlots.begin(), spriteDirtySlots.end());
+
+    uint32_t changedKeys = 0;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        SpriteNode *node = nodes[i];
+
+        // Until the end of Draw() rendererIndex still names the slot a node was last uploaded to.
+        uint32_t slot = node->rendererIndex;
+        bool isNew = slot >= uploadedNodes.size() || uploadedNodes[slot] != node;
+        if (!isNew && !areSortKeysStale && !node->WasDirtyThisFrame()
+            && !std::binary_search(spriteDirtySlots.begin(), spriteDirtySlots.end(), slot))
+            continue;
+
+        uint64_t key = MakeNodeSortKey(node, static_cast<uint32_t>(sortKeys[i] & spriteSortIdMask));
+        if (isNew || key != sortKeys[i]) {
+            sortKeys[i] = key;
+            changedKeys++;
+        }
+    }
+    areSortKeysStale = false;
+    return changedKeys;
+}
+
+void SpriteRenderer::SortNodes(uint32_t changedKeys) {
+    if (changedKeys == 0)
+        return;
+
+    if (changedKeys <= insertionSortLimit)
+        InsertionSortByKey(sortKeys, nodes);
+    else
+        RadixSortByKey(sortKeys, nodes, sortKeyScratch, nodeScratch);
+}
+
+void SpriteRenderer::UpdateInstanceBuffers(SpriteFrame &frame) {
+    uploadedNodes.resize(nodes.size(), nullptr);
+    if (useCompactInstances) {
+        compactInstances.resize(nodes.size());
+    } else {
+        instanceMatrices.resize(nodes.size());
+        instanceTiles.resize(nodes.size());
+    }
+
+    auto slotCount = static_cast<uint32_t>(nodes.size());
+    instanceBuildRanges.resize((slotCount + instanceBuildBatchSize - 1) / instanceBuildBatchSize);
+    auto forEachBuildRange = [this, slotCount](auto&& function) {
+        if (jobSystem != nullptr) {
+            jobSystem->ParallelForRange(slotCount, instanceBuildBatchSize, function);
+            return;
+        }
+        for (uint32_t begin = 0; begin < slotCount; begin += instanceBuildBatchSize)
+            function(begin, std::min(begin + instanceBuildBatchSize, slotCount));
+    };
+
+    forEachBuildRange([this](uint32_t begin, uint32_t end) {
+        BuildInstanceRange(begin, end);
+    });
+
+    bool needsMatrixInstances = false;
+    uint32_t matrixInstanceCount = 0;
+    for (const InstanceBuildRange &range : instanceBuildRanges) {
+        needsMatrixInstances |= range.needsMatrixInstances;
+        hasPromotionCandidates |= range.hasPromotionCandidates;
+        matrixInstanceCount += range.matrixInstanceCount;
+    }
+    if (needsMatrixInstances) {
+        SPDLOG_DEBUG("Sprite transform is not expressible as a compact instance, using matrix instances");
+        UseMatrixInstances();
+        UpdateInstanceBuffers(frame);
+        return;
+    }
+    if (!useCompactInstances) {
+        framesWithoutMatrixInstances = matrixInstanceCount == 0 ? framesWithoutMatrixInstances + 1 : 0;
+        if (framesWithoutMatrixInstances >= compactInstanceReturnFrames) {
+            SPDLOG_DEBUG("No sprite needs a matrix anymore, back to compact instances");
+            UseCompactInstances();
+            UpdateInstanceBuffers(frame);
+            return;
+        }
+    }
+
+    // The grid is shared, so moved sprites are put into their cells here, in slot order.
+    for (const InstanceBuildRange &range : instanceBuildRanges) {
+        for (uint32_t slot : range.movedSlots)
+            grid.Update(nodes[slot], GetNodeBounds(nodes[slot]));
+    }
+    spriteDirtySlots.clear();
+
+    // Every range gets its own part of the frame's bytes, filled by the same jobs.
+    frame.useCompactInstances = useCompactInstances;
+    frame.instanceCount = slotCount;
+    frame.instanceRanges.clear();
+    frame.tileRanges.clear();
+    GLsizeiptr instanceByteCount = 0;
+    GLsizeiptr tileByteCount = 0;
+    for (InstanceBuildRange &range : instanceBuildRanges) {
+        range.instanceByteOffset = instanceByteCount;
+        range.tileByteOffset = tileByteCount;
+        instanceByteCount += GetRangesSize(range.instanceRanges);
+        tileByteCount += GetRangesSize(range.tileRanges);
+        frame.instanceRanges.insert(frame.instanceRanges.end(), range.instanceRanges.begin(),
+                                    range.instanceRanges.end());
+        frame.tileRanges.insert(frame.tileRanges.end(), range.tileRanges.begin(), range.tileRanges.end());
+    }
+    frame.instanceBytes.resize(static_cast<size_t>(instanceByteCount));
+    frame.tileBytes.resize(static_cast<size_t>(tileByteCount));
+
+    const void* instanceSource = useCompactInstances ? static_cast<const void*>(compactInstances.data())
+                                                     : static_cast<const void*>(instanceMatrices.data());
+    forEachBuildRange([this, &frame, instanceSource](uint32_t begin, uint32_t) {
+        const InstanceBuildRange& range = instanceBuildRanges[begin / instanceBuildBatchSize];
+        CopySlotRanges(instanceSource, range.instanceRanges, frame.instanceBytes.data() + range.instanceByteOffset);
+        CopySlotRanges(instanceTiles.data(), range.tileRanges, frame.tileBytes.data() + range.tileByteOffset);
+    });
+}
+
+void SpriteRenderer::BuildInstanceRange(uint32_t begin, uint32_t end) {
+    InstanceBuildRange& range = instanceBuildRanges[begin / instanceBuildBatchSize];
+    range.instanceRanges.clear();
+    range.tileRanges.clear();
+    range.movedSlots.clear();
+    range.hasPromotionCandidates = false;
+    range.needsMatrixInstances = false;
+    range.matrixInstanceCount = 0;
+
+    // Slots recorded before a compaction or sort may now hold another node, rewriting them is harmless. UpdateSortKeys()
+    // already sorted them.
+    auto nextSpriteDirtySlot = std::lower_bound(spriteDirtySlots.begin(), spriteDirtySlots.end(), begin);
+
+    for (uint32_t i = begin; i < end; i++) {
+        SpriteNode *node = nodes[i];
+        node->rendererIndex = i;
+
+        while (nextSpriteDirtySlot != spriteDirtySlots.end() && *nextSpriteDirtySlot < i)
+            ++nextSpriteDirtySlot;
+
+        bool isNewInSlot = uploadedNodes[i] != node;
+        bool isMatrixDirty = isNewInSlot || node->WasDirtyThisFrame();
+        bool isSpriteDirty = isNewInSlot
+                             || (nextSpriteDirtySlot != spriteDirtySlots.end() && *nextSpriteDirtySlot == i);
+        if (!useCompactInstances) {
+            if (isMatrixDirty) {
+                SpriteInstance packedInstance{};
+                node->needsMatrixInstance = !PackSpriteTransform(*node->GetWorldTransformMatrix(), packedInstance);
+            }
+            range.matrixInstanceCount += node->needsMatrixInstance;
+        }
+        if (!isMatrixDirty && !isSpriteDirty) {
+            uint16_t threshold = GetStaticFrameThreshold(node->isStaticHint);
+            if (node->cleanFrames < threshold && ++node->cleanFrames == threshold)
+                range.hasPromotionCandidates = true;
+            continue;
+        }
+
+        node->cleanFrames = 0;
+
+        uploadedNodes[i] = node;
+
+        if (isMatrixDirty)
+            range.movedSlots.push_back(i);
+
+        if (useCompactInstances) {
+            SpriteInstance& instance = compactInstances[i];
+            if (isMatrixDirty && !PackSpriteTransform(*node->GetWorldTransformMatrix(), instance)) {
+                range.needsMatrixInstances = true;
+                return;
+            }
+            if (isSpriteDirty) {
+                instance.tileIndex = GetTileIndex(node);
+                instance.layer = node->GetRenderLayer();
+                SetSpriteInstancePalette(instance, node->GetPalette());
+            }
+
+            AppendSlotRange(range.instanceRanges, i, sizeof(SpriteInstance));
+            continue;
+        }
+
+        if (isMatrixDirty) {
+            instanceMatrices[i] = *node->GetWorldTransformMatrix();
+            AppendSlotRange(range.instanceRanges, i, sizeof(glm::mat4));
+        }
+
+        if (isSpriteDirty) {
+            instanceTiles[i] = glm::ivec2(GetTileIndex(node), node->GetRenderLayer() | node->GetPalette() << 8);
+            AppendSlotRange(range.tileRanges, i, sizeof(glm::ivec2));
+        }
+    }
+}
+
+void SpriteRenderer::UseMatrixInstances() {
+    useCompactInstances = false;
+    framesWithoutMatrixInstances = 0;
+    compactInstances = {};
+    std::fill(uploadedNodes.begin(), uploadedNodes.end(), nullptr);
+}
+
+void SpriteRenderer::UseCompactInstances() {
+    useCompactInstances = true;
+    instanceMatrices = {};
+    instanceTiles = {};
+    std::fill(uploadedNodes.begin(), uploadedNodes.end(), nullptr);
+}
+
+void SpriteRenderer::WriteDrawCommands(SpriteFrame &frame, GLuint indexCount, const FrameVector<uint32_t> &splits,
+                                       bool isCulling) {
+    std::vector<DrawElementsIndirectCommand>& drawCommands = frame.drawCommands;
+    std::vector<uint16_t>& drawCommandMaterials = frame.drawCommandMaterials;
+    uint32_t& opaqueCommandCount = frame.opaqueCommandCount;
+    drawCommands.clear();
+    drawCommandMaterials.clear();
+    opaqueCommandCount = 0;
+
+    // Slots arrive in increasing order. A command grows until the material changes, a slot is skipped, or one of the
+    // splits (tile layer passes and the end of the opaque part) breaks the run.
+    size_t nextSplit = 0;
+    auto addSlot = [&](uint32_t slot) {
+        bool isOpaque = slot < frame.opaqueEnd;
+        auto material = static_cast<uint16_t>(isOpaque ? MaterialFirstSortMaterial(sortKeys[slot])
+                                                       : SpriteSortMaterial(sortKeys[slot]));
+        while (nextSplit < splits.size() && splits[nextSplit] < slot)
+            nextSplit++;
+        bool isSplit = nextSplit < splits.size() && splits[nextSplit] == slot;
+
+        if (!isSplit && !drawCommands.empty() && drawCommandMaterials.back() == material
+            && drawCommands.back().baseInstance + drawCommands.back().instanceCount == slot) {
+            drawCommands.back().instanceCount++;
+            return;
+        }
+
+        drawCommands.push_back({indexCount, 1, 0, 0, slot});
+        drawCommandMaterials.push_back(material);
+        if (isOpaque)
+            opaqueCommandCount++;
+    };
+
+    if (!isCulling) {
+        for (uint32_t slot = 0; slot < nodes.size(); slot++)
+            addSlot(slot);
+        return;
+    }
+
+    FrameVector<uint32_t> visibleSlots;
+    for (uint8_t layer = 0; layer < maxRenderLayers; layer++) {
+        if (!isRenderLayerUsed[layer])
+            continue;
+
+        grid.Query(GetLayerViewBounds(frame, layer), [&visibleSlots, layer](SpriteNode *node) {
+            if (node->GetRenderLayer() == layer)
+                visibleSlots.push_back(node->rendererIndex);
+        });
+    }
+    std::sort(visibleSlots.begin(), visibleSlots.end());
+    for (uint32_t slot : visibleSlots)
+        addSlot(slot);
+}
+
+GLsizeiptr SpriteRenderer::UploadInstances(const SpriteFrame &frame) {
+    GLsizeiptr instanceSize = frame.useCompactInstances ? sizeof(SpriteInstance) : sizeof(glm::mat4);
+    GLsizeiptr size = frame.instanceCount * instanceSize;
+    ApplySlotRanges(submittedInstances, size, frame.instanceRanges, frame.instanceBytes);
+    if (frame.useCompactInstances)
+        return compactInstanceBuffer->WriteRanges(submittedInstances.data(), size, frame.instanceRanges);
+
+    GLsizeiptr tileSize = frame.instanceCount * sizeof(glm::ivec2);
+    ApplySlotRanges(submittedTiles, tileSize, frame.tileRanges, frame.tileBytes);
+    GLsizeiptr uploadedBytes = matrixBuffer->WriteRanges(submittedInstances.data(), size, frame.instanceRanges);
+    uploadedBytes += tileBuffer->WriteRanges(submittedTiles.data(), tileSize, frame.tileRanges);
+    return uploadedBytes;
+}
+
+void SpriteRenderer::DrawSpriteSlots(const SpriteFrame &frame, uint32_t begin, uint32_t end, AlphaMode alphaMode) {
+    if (begin >= end)
+        return;
+
+    // The opaque commands are grouped by material, so that part is only ever drawn as a whole.
+    const std::vector<DrawElementsIndirectCommand>& drawCommands = frame.drawCommands;
+    const std::vector<uint16_t>& drawCommandMaterials = frame.drawCommandMaterials;
+    auto firstCommand = drawCommands.begin();
+    auto lastCommand = drawCommands.begin() + frame.opaqueCommandCount;
+    if (begin >= frame.opaqueEnd) {
+        auto isBefore = [](const DrawElementsIndirectCommand &command, uint32_t slot) {
+            return command.baseInstance < slot;
+        };
+        firstCommand = std::lower_bound(lastCommand, drawCommands.end(), begin, isBefore);
+        lastCommand = std::lower_bound(firstCommand, drawCommands.end(), end, isBefore);
+    }
+    if (firstCommand == lastCommand)
+        return;
+
+    const ShaderWrapper& activeShader = frame.isGpuCulling ? *culledShader
+                                        : frame.useCompactInstances ? *compactShader : *shader;
+    activeShader.Activate();
+    activeShader.SetInt("texture_diffuse", 0);
+    activeShader.SetInt("texture_indices", indexTextureUnit);
+    activeShader.SetInt("palettes", paletteTextureUnit);
+    activeShader.SetInt("alphaMode", static_cast<int>(alphaMode));
+
+    GLuint commandBuffer = drawCommandBuffer->GetBufferId();
+    GLintptr commandRegionOffset = drawCommandBuffer->GetCurrentRegionOffset();
+    if (frame.isGpuCulling) {
+        stateCache->BindVertexArray(culledTileVAO->GetVaoId());
+        glBindVertexBuffer(culledSlotBindingIndex, gpuCuller->GetVisibleSlotBuffer(), 0, sizeof(GLuint));
+        stateCache->BindStorageBuffer(GpuSpriteCuller::instanceBlockBinding, compactInstanceBuffer->GetBufferId(),
+                                      compactInstanceBuffer->GetCurrentRegionOffset(),
+                                      static_cast<GLsizeiptr>(frame.instanceCount * sizeof(SpriteInstance)));
+        commandBuffer = gpuCuller->GetCommandBuffer();
+        commandRegionOffset = 0;
+    } else if (frame.useCompactInstances) {
+        stateCache->BindVertexArray(compactTileVAO->GetVaoId());
+        glBindVertexBuffer(compactInstanceBindingIndex, compactInstanceBuffer->GetBufferId(),
+                           compactInstanceBuffer->GetCurrentRegionOffset(), sizeof(SpriteInstance));
+    } else {
+        stateCache->BindVertexArray(tileVAO->GetVaoId());
+        glBindVertexBuffer(matrixBindingIndex, matrixBuffer->GetBufferId(), matrixBuffer->GetCurrentRegionOffset(),
+                           sizeof(glm::mat4));
+        glBindVertexBuffer(tileBindingIndex, tileBuffer->GetBufferId(), tileBuffer->GetCurrentRegionOffset(),
+                           sizeof(glm::ivec2));
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+
+    // One multi-draw per run of commands sharing a material.
+    auto firstIndex = static_cast<size_t>(firstCommand - drawCommands.begin());
+    auto lastIndex = static_cast<size_t>(lastCommand - drawCommands.begin());
+    while (firstIndex < lastIndex) {
+        uint16_t material = drawCommandMaterials[firstIndex];
+        size_t runEnd = firstIndex + 1;
+        while (runEnd < lastIndex && drawCommandMaterials[runEnd] == material)
+            runEnd++;
+
+        BindMaterial(activeShader, material);
+        GLintptr commandOffset = commandRegionOffset + firstIndex * sizeof(DrawElementsIndirectCommand);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<const void*>(commandOffset),
+                                    static_cast<GLsizei>(runEnd - firstIndex), 0);
+        firstIndex = runEnd;
+    }
+}
+
+void SpriteRenderer::BindMaterial(const ShaderWrapper &spriteShader, uint16_t material) {
+    const SpriteMaterial& boundMaterial = materials[material];
+    GLenum target = useTileArray ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+    stateCache->BindTexture(boundMaterial.isIndexed ? indexTextureUnit : 0, target, boundMaterial.texture);
+    stateCache->BindStorageBuffer(tileRectBlockBinding, boundMaterial.tileRectBuffer);
+    stateCache->BindStorageBuffer(tileOpacityBlockBinding, boundMaterial.tileOpacityBuffer);
+    // -1 samples colours, a palette row resolves indices.
+    spriteShader.SetInt("materialPalette", boundMaterial.isIndexed ? boundMaterial.palette : -1);
+    materialBindCount++;
 }
 
-void SpriteRenderer::UpdateMatrixBuffer() {
-    std::vector<glm::mat4> matrices;
-    for (SpriteNode *node: nodes) {
-        matrices.push_back(*node->GetWorldTransformMatrix());
+bool SpriteRenderer::DrawTileLayer(const SpriteFrame &frame, const SpriteFramePass &pass, const BakedTileLayer &layer,
+                                   AlphaMode alphaMode) {
+    const glm::mat4& transform = pass.tileLayerTransform;
+    glm::ivec2 size = layer.GetSize();
+
+    if (frame.isCulling) {
+        glm::vec4 cornerA = transform * glm::vec4(-0.5f, 0.5f, 0.f, 1.f);
+        glm::vec4 cornerB = transform * glm::vec4(size.x - 0.5f, size.y + 0.5f, 0.f, 1.f);
+        Bounds2D layerBounds = {glm::min(glm::vec2(cornerA), glm::vec2(cornerB)),
+                                glm::max(glm::vec2(cornerA), glm::vec2(cornerB))};
+        if (!layerBounds.Overlaps(GetLayerViewBounds(frame, pass.renderLayer)))
+            return false;
     }
 
-    glBindBuffer(GL_ARRAY_BUFFER, matrixBuffer);
-    glBufferData(GL_ARRAY_BUFFER, matrices.size() * sizeof(glm::mat4), &matrices[0], GL_DYNAMIC_DRAW);
+    bool isMesh = layer.GetMode() == TileLayerMode::GreedyMesh;
+    const ShaderWrapper& activeShader = isMesh ? *meshShader : *layerShader;
+    activeShader.Activate();
+    activeShader.SetMat4F("model", transform);
+    activeShader.SetIVec2("layerSize", size);
+    activeShader.SetInt("renderLayer", pass.renderLayer);
+    activeShader.SetInt("alphaMode", static_cast<int>(alphaMode));
+    activeShader.SetInt("texture_diffuse", 0);
+    if (!useTileArray) {
+        activeShader.SetInt("tilesPerRow", materials[0].tilesPerRow);
+        activeShader.SetFloat("uvTileSize", 1.f / static_cast<float>(materials[0].tilesPerRow));
+    }
+    stateCache->BindTexture(0, useTileArray ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D, materials[0].texture);
+    stateCache->BindStorageBuffer(tileOpacityBlockBinding, materials[0].tileOpacityBuffer);
+
+    if (isMesh) {
+        layer.GetMesh()->Draw(*stateCache);
+        if (alphaMode != AlphaMode::TranslucentTexels)
+            tileMeshQuadCount += layer.GetMesh()->GetQuadCount();
+        return true;
+    }
+
+    activeShader.SetInt("tileIndices", 1);
+
+    stateCache->BindTexture(1, GL_TEXTURE_2D, layer.GetIndexTexture());
+
+    stateCache->BindVertexArray(layerVAO->GetVaoId());
+    glDrawElements(GL_TRIANGLES, layerVAO->GetIndicesCount(), GL_UNSIGNED_INT, nullptr);
+    return true;
+}
+
+void SpriteRenderer::DrawStaticBatch(const SpriteFrame &frame, const BakedSpriteBatch &batch, AlphaMode alphaMode) {
+    compactShader->Activate();
+    compactShader->SetInt("alphaMode", static_cast<int>(alphaMode));
+    compactShader->SetInt("texture_diffuse", 0);
+    compactShader->SetInt("texture_indices", indexTextureUnit);
+    compactShader->SetInt("palettes", paletteTextureUnit);
+    BindMaterial(*compactShader, batch.GetMaterial());
+
+    stateCache->BindVertexArray(compactTileVAO->GetVaoId());
+    Bounds2D layerViewBounds = GetLayerViewBounds(frame, batch.GetRenderLayer());
+    batch.Draw(compactInstanceBindingIndex, frame.isCulling ? &layerViewBounds : nullptr);
+}
+
+void SpriteRenderer::AddTileLayer(TileLayer *layer) {
+    layer->SetId(nextTileLayerId++);
+    tileLayers.push_back(layer);
+}
+
+void SpriteRenderer::RemoveTileLayer(TileLayer *layer) {
+    std::erase(tileLayers, layer);
+    removedTileLayers.push_back(layer->GetId());
+}
+
+uint16_t SpriteRenderer::GetTileIndex(glm::ivec2 tileCoord, uint16_t material) const {
+    return static_cast<uint16_t>(tileCoord.y * materials[material].tilesPerRow + tileCoord.x);
+}
+
+GLuint SpriteRenderer::GetQuadIndexCount() const {
+    return tileVAO->GetIndicesCount();
+}
+
+TileOpacity SpriteRenderer::GetTileOpacity(uint16_t tileIndex, uint16_t material) const {
+    const std::vector<TileOpacity>& tileOpacities = materials[material].tileOpacities;
+    if (tileIndex >= tileOpacities.size())
+        return TileOpacity::Translucent;
+    return tileOpacities[tileIndex];
+}
+
+void SpriteRenderer::SetOpaquePassEnabled(bool isEnabled) {
+    if (isOpaquePassEnabled == isEnabled)
+        return;
+
+    isOpaquePassEnabled = isEnabled;
+    areSortKeysStale = true;
+}
+
+bool SpriteRenderer::IsOpaquePassEnabled() const {
+    return isOpaquePassEnabled;
+}
+
+void SpriteRenderer::SetFragmentCountingEnabled(bool isEnabled) {
+    isCountingFragments = isEnabled;
+}
+
+void SpriteRenderer::ReadFragmentCount() {
+    GLuint query = fragmentQueries[fragmentQueryIndex];
+    if (!isFragmentQueryPending[fragmentQueryIndex])
+        return;
+
+    GLuint isAvailable = GL_FALSE;
+    glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &isAvailable);
+    if (isAvailable == GL_FALSE)
+        return;
+
+    glGetQueryObjectuiv(query, GL_QUERY_RESULT, &fragmentCount);
+    isFragmentQueryPending[fragmentQueryIndex] = false;
+}
+
+Bounds2D SpriteRenderer::GetNodeBounds(const SpriteNode *node) {
+    const glm::mat4& transform = *node->GetWorldTransformMatrix();
+    glm::vec2 center(transform[3].x, transform[3].y);
+    glm::vec2 halfExtent = 0.5f * glm::vec2(std::abs(transform[0].x) + std::abs(transform[1].x),
+                                            std::abs(transform[0].y) + std::abs(transform[1].y));
+    return {center - halfExtent, center + halfExtent};
+}
+
+Bounds2D SpriteRenderer::GetLayerViewBounds(const SpriteFrame &frame, uint8_t layer) {
+    glm::vec2 offset(frame.renderLayerOffsets[layer]);
+    return {frame.viewBounds.min - offset, frame.viewBounds.max - offset};
 }
 
-void SpriteRenderer::UpdateTilePositionBuffer() {
-    std::vector<glm::vec<2, int>> tileCoords;
-    for (SpriteNode *node: nodes) {
-        tileCoords.push_back(node->getSprite()->GetTileMapPosition());
+uint8_t SpriteRenderer::AddRenderLayer() {
+    for (uint8_t layer = 1; layer < maxRenderLayers; layer++) {
+        if (isRenderLayerUsed[layer])
+            continue;
+
+        isRenderLayerUsed[layer] = true;
+        return layer;
     }
 
-    glBindBuffer(GL_ARRAY_BUFFER, textureCordBuffer);
-    glBufferData(GL_ARRAY_BUFFER, tileCoords.size() * sizeof(glm::vec<2, int>), &tileCoords[0], GL_DYNAMIC_DRAW);
+    SPDLOG_ERROR("No free render layer, drawing in the world layer");
+    return 0;
+}
+
+void SpriteRenderer::RemoveRenderLayer(uint8_t layer) {
+    if (layer == 0)
+        return;
+
+    isRenderLayerUsed[layer] = false;
+    SetRenderLayerOffset(layer, glm::vec2(0.f));
+}
+
+void SpriteRenderer::SetRenderLayerOffset(uint8_t layer, glm::vec2 offset) {
+    if (layer == 0)
+        return;
+
+    renderLayerOffsets[layer] = glm::vec4(offset, 0.f, 0.f);
+    areRenderLayerOffsetsDirty = true;
+}
+
+void SpriteRenderer::SetViewBounds(const Bounds2D &bounds) {
+    viewBounds = bounds;
+    hasViewBounds = true;
+}
+
+void SpriteRenderer::SetJobSystem(JobSystem *newJobSystem) {
+    jobSystem = newJobSystem;
+}
+
+void SpriteRenderer::SetCameraMatrices(const glm::mat4 &projection, const glm::mat4 &view) {
+    cameraProjection = projection;
+    cameraView = view;
+}
+
+void SpriteRenderer::SetCullingEnabled(bool isEnabled) {
+    isCullingEnabled = isEnabled;
+}
+
+bool SpriteRenderer::IsCullingEnabled() const {
+    return isCullingEnabled;
+}
+
+void SpriteRenderer::SetGpuCullingEnabled(bool isEnabled) {
+    isGpuCullingEnabled = isEnabled;
+}
+
+bool SpriteRenderer::IsGpuCullingEnabled() const {
+    return isGpuCullingEnabled;
+}
+
+uint32_t SpriteRenderer::ReadGpuVisibleInstanceCount() const {
+    return gpuCuller->ReadVisibleCount();
+}
+
+uint16_t SpriteRenderer::GetTileIndex(const SpriteNode *node) const {
+    return GetTileIndex(node->getSprite()->GetTileMapPosition(), GetNodeMaterial(node));
+}
+
+uint16_t SpriteRenderer::GetNodeMaterial(const SpriteNode *node) const {
+    // Sprites made before their material was added, or with a failed one, fall back to the default atlas.
+    uint16_t material = node->getSprite()->GetMaterial();
+    return material < materials.size() ? material : 0;
 }
 
 void SpriteRenderer::Draw() {
-    auto comparator = [](Node *A, Node *B)-> bool {
-        glm::mat4 matrixA = *A->GetWorldTransformMatrix();
-        glm::mat4 matrixB = *B->GetWorldTransformMatrix();
+    Prepare(drawFrame);
+    Submit(drawFrame);
+}
 
-        if (matrixA[3][2] == matrixB[3][2])
-            return A < B;
+void SpriteRenderer::Prepare(SpriteFrame &frame) {
+    auto prepareStartTimePoint = std::chrono::high_resolution_clock::now();
+
+    frame.removedStaticBatches.clear();
+    if (!demotedNodes.empty() || hasRemovedStaticNodes)
+        DemoteStaticNodes(frame);
+    if (hasPromotionCandidates)
+        PromoteStaticNodes();
+    if (hasRemovedNodes)
+        CompactNodes();
+
+    uint32_t changedKeys = UpdateSortKeys();
+    SortNodes(changedKeys);
+
+    auto buildStartTimePoint = std::chrono::high_resolution_clock::now();
+    UpdateInstanceBuffers(frame);
+    std::chrono::duration<float, std::milli> buildDuration = std::chrono::high_resolution_clock::now() - buildStartTimePoint;
+
+    frame.projection = cameraProjection;
+    frame.view = cameraView;
+    frame.viewBounds = viewBounds;
+    frame.renderLayerOffsets = renderLayerOffsets;
+    frame.areRenderLayerOffsetsDirty = areRenderLayerOffsetsDirty;
+    areRenderLayerOffsetsDirty = false;
+
+    uint32_t staticInstanceCount = 0;
+    uint32_t staticChunkCount = 0;
+    frame.staticBatchUploads.clear();
+    for (const auto& [depthBits, batch] : staticBatches) {
+        StaticBatchUpload& upload = frame.staticBatchUploads.emplace_back();
+        if (batch->Rebuild(*this, upload))
+            upload.key = depthBits;
         else
-            return matrixA[3][2] < matrixB[3][2];
-    };
+            frame.staticBatchUploads.pop_back();
+        staticInstanceCount += batch->GetNodeCount();
+        staticChunkCount += batch->GetChunkCount();
+    }
+
+    frame.removedTileLayers.clear();
+    std::swap(frame.removedTileLayers, removedTileLayers);
+    frame.tileLayerUploads.clear();
+    for (TileLayer *layer : tileLayers) {
+        TileLayerUpload& upload = frame.tileLayerUploads.emplace_back();
+        if (!layer->TakeUpload(upload))
+            frame.tileLayerUploads.pop_back();
+    }
+
+    // Tile layers and static batches are drawn before the first translucent sprite at or above their depth.
+    frame.passes.clear();
+    for (TileLayer *layer : tileLayers) {
+        frame.passes.push_back({layer->GetDepth(), layer->GetId(), layer->GetWorldTransform(), layer->GetRenderLayer(),
+                                0});
+    }
+    for (const auto& [depthBits, batch] : staticBatches)
+        frame.passes.push_back({batch->GetDepth(), 0, glm::mat4(1.f), batch->GetRenderLayer(), depthBits});
+    std::stable_sort(frame.passes.begin(), frame.passes.end(), [](const SpriteFramePass &A, const SpriteFramePass &B) {
+        return A.depth < B.depth;
+    });
+    frame.splits.clear();
+    for (const SpriteFramePass &pass : frame.passes) {
+        uint64_t passKey = MakeSpriteSortKey(translucentSortLayer, pass.depth, 0, 0);
+        frame.splits.push_back(static_cast<uint32_t>(std::lower_bound(sortKeys.begin(), sortKeys.end(), passKey)
+                                                     - sortKeys.begin()));
+    }
+
+    frame.opaqueEnd = static_cast<uint32_t>(std::lower_bound(sortKeys.begin(), sortKeys.end(), translucentKeyBegin)
+                                            - sortKeys.begin());
+    FrameVector<uint32_t> runBreaks;
+    runBreaks.push_back(frame.opaqueEnd);
+    runBreaks.insert(runBreaks.end(), frame.splits.begin(), frame.splits.end());
+    std::sort(runBreaks.begin(), runBreaks.end());
+
+    frame.isCulling = isCullingEnabled && hasViewBounds;
+    // The compute pass reads the camera from the TransformationMatrices block and only knows compact instances.
+    frame.isGpuCulling = frame.isCulling && isGpuCullingEnabled && useCompactInstances;
+    WriteDrawCommands(frame, GetQuadIndexCount(), runBreaks, frame.isCulling && !frame.isGpuCulling);
+
+    frame.isOpaquePassEnabled = isOpaquePassEnabled;
+    frame.hasTranslucentTiles = std::any_of(materials.begin(), materials.end(), [](const SpriteMaterial &material) {
+        return material.hasTranslucentTiles;
+    });
+    frame.isCountingFragments = isCountingFragments;
 
-    for (SpriteNode *node: nodes) {
-        if (node->WasDirtyThisFrame()) {
-            std::sort(nodes.begin(), nodes.end(), comparator);
-            UpdateMatrixBuffer();
-            break;
+    uint32_t visibleInstanceCount = 0;
+    for (const DrawElementsIndirectCommand &command : frame.drawCommands)
+        visibleInstanceCount += command.instanceCount;
+
+    std::chrono::duration<float, std::milli> prepareDuration = std::chrono::high_resolution_clock::now() - prepareStartTimePoint;
+    std::lock_guard lock(statisticsMutex);
+    statistics.prepareMilliseconds = prepareDuration.count();
+    statistics.instanceBuildMilliseconds = buildDuration.count();
+    statistics.instanceCount = frame.instanceCount;
+    // The GPU count arrives with the submit a frame later.
+    if (!frame.isGpuCulling)
+        statistics.visibleInstanceCount = visibleInstanceCount;
+    statistics.drawRunCount = static_cast<uint32_t>(frame.drawCommands.size());
+    statistics.bytesPerInstance = useCompactInstances ? sizeof(SpriteInstance) : sizeof(glm::mat4) + sizeof(glm::ivec2);
+    statistics.resortedKeys = changedKeys;
+    statistics.staticInstanceCount = staticInstanceCount;
+    statistics.staticChunkCount = staticChunkCount;
+}
+
+void SpriteRenderer::Submit(const SpriteFrame &frame) {
+    auto submitStartTimePoint = std::chrono::high_resolution_clock::now();
+
+    if (frame.isCountingFragments)
+        glBeginQuery(GL_SAMPLES_PASSED, fragmentQueries[fragmentQueryIndex]);
+
+    for (uint64_t key : frame.removedStaticBatches)
+        bakedBatches.erase(key);
+    for (const StaticBatchUpload &upload : frame.staticBatchUploads) {
+        std::unique_ptr<BakedSpriteBatch>& batch = bakedBatches[upload.key];
+        if (batch == nullptr)
+            batch = std::make_unique<BakedSpriteBatch>();
+        batch->Upload(upload);
+    }
+    for (uint32_t id : frame.removedTileLayers)
+        bakedTileLayers.erase(id);
+    for (const TileLayerUpload &upload : frame.tileLayerUploads) {
+        std::unique_ptr<BakedTileLayer>& layer = bakedTileLayers[upload.id];
+        if (layer == nullptr)
+            layer = std::make_unique<BakedTileLayer>();
+        layer->Upload(upload, *stateCache);
+    }
+
+    GLsizeiptr uploadedBytes = UploadInstances(frame);
+
+    // The camera usually stands still between frames.
+    if (frame.projection != submittedProjection || frame.view != submittedView) {
+        CameraBlock camera = {frame.projection, frame.view};
+        glBindBuffer(GL_UNIFORM_BUFFER, cameraBuffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, cameraBlock.Size, &camera);
+        submittedProjection = frame.projection;
+        submittedView = frame.view;
+        uploadedBytes += cameraBlock.Size;
+    }
+    if (frame.areRenderLayerOffsetsDirty) {
+        glBindBuffer(GL_UNIFORM_BUFFER, renderLayerBuffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(frame.renderLayerOffsets), frame.renderLayerOffsets.data());
+        uploadedBytes += sizeof(frame.renderLayerOffsets);
+    }
+
+    auto drawRunCount = static_cast<uint32_t>(frame.drawCommands.size());
+    if (drawRunCount > 0) {
+        GLsizeiptr size = drawRunCount * sizeof(DrawElementsIndirectCommand);
+        std::memcpy(drawCommandBuffer->BeginWrite(size), frame.drawCommands.data(), size);
+        drawCommandBuffer->EndWrite(size);
+    }
+
+    uint32_t gpuVisibleInstanceCount = 0;
+    if (frame.isGpuCulling && drawRunCount > 0) {
+        gpuCuller->Cull(compactInstanceBuffer->GetBufferId(), compactInstanceBuffer->GetCurrentRegionOffset(),
+                        frame.instanceCount, drawCommandBuffer->GetBufferId(),
+                        drawCommandBuffer->GetCurrentRegionOffset(), drawRunCount);
+        gpuVisibleInstanceCount = gpuCuller->GetLatestVisibleCount();
+    }
+
+    // ImGui, the uploads and the cull passes above change state without the cache.
+    stateCache->Reset();
+    stateCache->BindTexture(paletteTextureUnit, GL_TEXTURE_2D, paletteTexture);
+    materialBindCount = 0;
+
+    uint32_t drawnLayerCount = 0;
+    tileMeshQuadCount = 0;
+    auto drawPass = [this, &frame, &drawnLayerCount](const SpriteFramePass &pass, AlphaMode alphaMode) {
+        if (pass.tileLayerId == 0) {
+            auto batch = bakedBatches.find(pass.staticBatchKey);
+            if (batch != bakedBatches.end())
+                DrawStaticBatch(frame, *batch->second, alphaMode);
+            return;
         }
+
+        auto layer = bakedTileLayers.find(pass.tileLayerId);
+        if (layer != bakedTileLayers.end() && DrawTileLayer(frame, pass, *layer->second, alphaMode)
+            && alphaMode != AlphaMode::TranslucentTexels)
+            drawnLayerCount++;
+    };
+
+    if (frame.isOpaquePassEnabled) {
+        // Opaque texels front to back, so whatever they cover is rejected by the depth test.
+        stateCache->SetBlendEnabled(false);
+        DrawSpriteSlots(frame, 0, frame.opaqueEnd, AlphaMode::OpaqueTexels);
+        for (auto pass = frame.passes.rbegin(); pass != frame.passes.rend(); ++pass)
+            drawPass(*pass, AlphaMode::OpaqueTexels);
+        stateCache->SetBlendEnabled(true);
+        stateCache->SetDepthMask(false);
     }
 
-    UpdateTilePositionBuffer();
+    // Layers and batches mix tile kinds, their opaque texels were drawn above. Skipped when nothing is translucent.
+    bool drawsPassesBlended = !frame.isOpaquePassEnabled || frame.hasTranslucentTiles;
+    AlphaMode blendedPassMode = frame.isOpaquePassEnabled ? AlphaMode::TranslucentTexels : AlphaMode::VisibleTexels;
+    uint32_t begin = frame.opaqueEnd;
+    for (size_t i = 0; i < frame.passes.size(); i++) {
+        DrawSpriteSlots(frame, begin, frame.splits[i], AlphaMode::VisibleTexels);
+        begin = frame.splits[i];
+        if (drawsPassesBlended)
+            drawPass(frame.passes[i], blendedPassMode);
+    }
+    DrawSpriteSlots(frame, begin, frame.instanceCount, AlphaMode::VisibleTexels);
+    stateCache->SetDepthMask(true);
+    // Code outside the renderer binds textures without selecting a unit.
+    stateCache->SetActiveTextureUnit(0);
 
-    shader->Activate();
-    shader->SetInt("tileSize", tileSize);
-    shader->SetInt("tileMapSize", tileMapSize);
+    if (frame.useCompactInstances) {
+        compactInstanceBuffer->FenceCurrentRegion();
+    } else {
+        matrixBuffer->FenceCurrentRegion();
+        tileBuffer->FenceCurrentRegion();
+    }
+    if (drawRunCount > 0)
+        drawCommandBuffer->FenceCurrentRegion();
 
-    glActiveTexture(GL_TEXTURE0);
-    shader->SetFloat("texture_diffuse", 0);
-    glBindTexture(GL_TEXTURE_2D, tileMap);
+    if (frame.isCountingFragments) {
+        glEndQuery(GL_SAMPLES_PASSED);
+        isFragmentQueryPending[fragmentQueryIndex] = true;
+        fragmentQueryIndex = (fragmentQueryIndex + 1) % fragmentQueries.size();
+        ReadFragmentCount();
+    }
 
-    glBindVertexArray(tileVAO->GetVaoId());
-    glDrawElementsInstanced(GL_TRIANGLES, tileVAO->GetIndicesCount(), GL_UNSIGNED_INT, 0, nodes.size());
+    GlStateCallCounts stateCallCounts = stateCache->TakeCallCounts();
+    std::chrono::duration<float, std::milli> submitDuration = std::chrono::high_resolution_clock::now() - submitStartTimePoint;
+    std::lock_guard lock(statisticsMutex);
+    statistics.submitMilliseconds = submitDuration.count();
+    if (frame.isGpuCulling)
+        statistics.visibleInstanceCount = gpuVisibleInstanceCount;
+    statistics.materialBindCount = materialBindCount;
+    statistics.tileLayerCount = drawnLayerCount;
+    statistics.tileMeshQuadCount = tileMeshQuadCount;
+    statistics.uploadedBytes = static_cast<uint32_t>(uploadedBytes);
+    statistics.fragmentCount = fragmentCount;
+    statistics.stateCallCount = stateCallCounts.issued;
+    statistics.redundantStateCallCount = stateCallCounts.redundant;
+}
+
+SpriteRendererStatistics SpriteRenderer::GetStatistics() const {
+    std::lock_guard lock(statisticsMutex);
+    return statistics;
+}
+
+SpriteSortTimings SpriteRenderer::MeasureSortTimes(uint32_t spriteCount) {
+    using Milliseconds = std::chrono::duration<float, std::milli>;
+
+    std::mt19937 generator(1234);
+    std::uniform_real_distribution<float> depthDistribution(-100.f, 100.f);
+
+    std::vector<glm::mat4> matrices(spriteCount, glm::mat4(1.f));
+    std::vector<uint64_t> keys(spriteCount);
+    for (uint32_t i = 0; i < spriteCount; i++) {
+        matrices[i][3][2] = depthDistribution(generator);
+        keys[i] = MakeSpriteSortKey(0, matrices[i][3][2], 0, i);
+    }
+
+    SpriteSortTimings timings;
+
+    std::vector<const glm::mat4*> matrixPointers(spriteCount);
+    for (uint32_t i = 0; i < spriteCount; i++)
+        matrixPointers[i] = &matrices[i];
+
+    auto startTimePoint = std::chrono::high_resolution_clock::now();
+    std::sort(matrixPointers.begin(), matrixPointers.end(), [](const glm::mat4 *A, const glm::mat4 *B) {
+        glm::mat4 matrixA = *A;
+        glm::mat4 matrixB = *B;
+
+        if (matrixA[3][2] == matrixB[3][2])
+            return A < B;
+        return matrixA[3][2] < matrixB[3][2];
+    });
+    timings.comparatorMilliseconds = Milliseconds(std::chrono::high_resolution_clock::now() - startTimePoint).count();
+
+    std::vector<uint32_t> values(spriteCount);
+    for (uint32_t i = 0; i < spriteCount; i++)
+        values[i] = i;
+    std::vector<uint64_t> keyScratch;
+    std::vector<uint32_t> valueScratch;
+
+    startTimePoint = std::chrono::high_resolution_clock::now();
+    RadixSortByKey(keys, values, keyScratch, valueScratch);
+    timings.radixMilliseconds = Milliseconds(std::chrono::high_resolution_clock::now() - startTimePoint).count();
+
+    std::uniform_int_distribution<uint32_t> indexDistribution(0, spriteCount - 1);
+    for (uint32_t i = 0; i < insertionSortLimit; i++) {
+        uint64_t& key = keys[indexDistribution(generator)];
+        key = MakeSpriteSortKey(0, depthDistribution(generator), 0, static_cast<uint32_t>(key & spriteSortIdMask));
+    }
+
+    startTimePoint = std::chrono::high_resolution_clock::now();
+    InsertionSortByKey(keys, values);
+    timings.insertionMilliseconds = Milliseconds(std::chrono::high_resolution_clock::now() - startTimePoint).count();
+
+    return timings;
 }
 
 SpriteRenderer::~SpriteRenderer() {
-    glDeleteBuffers(1, &matrixBuffer);
-    glDeleteBuffers(1, &textureCordBuffer);
+    glDeleteBuffers(1, &cameraBuffer);
+    glDeleteBuffers(1, &renderLayerBuffer);
+    glDeleteQueries(static_cast<GLsizei>(fragmentQueries.size()), fragmentQueries.data());
+    glDeleteTextures(1, &paletteTexture);
+    for (const SpriteMaterial &material : materials) {
+        glDeleteTextures(1, &material.texture);
+        glDeleteBuffers(1, &material.tileRectBuffer);
+        glDeleteBuffers(1, &material.tileOpacityBuffer);
+    }
 }
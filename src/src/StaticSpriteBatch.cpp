@@ -0,0 +1,170 @@
+#include "StaticSpriteBatch.h"
+
+#include <cmath>
+
+#include "DrawElementsIndirectCommand.h"
+#include "Nodes/SpriteNode.h"
+#include "SpriteInstance.h"
+#include "SpriteRenderer.h"
+#include "Sprite.h"
+
+StaticSpriteBatch::StaticSpriteBatch(float depth, uint8_t layer, uint16_t material)
+        : depth(depth), layer(layer), material(material), nodeCount(0), isDirty(false) {}
+
+void StaticSpriteBatch::Add(SpriteNode *node) {
+    uint64_t key = GetChunkKey(node);
+    std::vector<SpriteNode*>& chunkNodes = chunks[key].nodes;
+
+    node->staticBatch = this;
+    node->staticChunk = key;
+    node->staticIndex = static_cast<uint32_t>(chunkNodes.size());
+    chunkNodes.push_back(node);
+
+    nodeCount++;
+    isDirty = true;
+}
+
+void StaticSpriteBatch::Remove(SpriteNode *node) {
+    auto chunk = chunks.find(node->staticChunk);
+    std::vector<SpriteNode*>& chunkNodes = chunk->second.nodes;
+
+    SpriteNode* last = chunkNodes.back();
+    chunkNodes[node->staticIndex] = last;
+    last->staticIndex = node->staticIndex;
+    chunkNodes.pop_back();
+    if (chunkNodes.empty())
+        chunks.erase(chunk);
+
+    node->staticBatch = nullptr;
+    nodeCount--;
+    isDirty = true;
+}
+
+bool StaticSpriteBatch::Rebuild(const SpriteRenderer &renderer, StaticBatchUpload &upload) {
+    if (!isDirty)
+        return false;
+
+    upload.material = material;
+    upload.renderLayer = layer;
+    std::vector<SpriteInstance>& instances = upload.instances;
+    std::vector<DrawElementsIndirectCommand>& commands = upload.commands;
+    std::vector<Bounds2D>& commandBounds = upload.commandBounds;
+    instances.clear();
+    commands.clear();
+    commandBounds.clear();
+    instances.reserve(nodeCount);
+    commands.reserve(chunks.size());
+
+    for (const auto& [key, chunk] : chunks) {
+        Bounds2D bounds = chunk.nodes.front()->gridBounds;
+        auto firstInstance = static_cast<GLuint>(instances.size());
+
+        for (SpriteNode* node : chunk.nodes) {
+            SpriteInstance& instance = instances.emplace_back();
+            PackSpriteTransform(*node->GetWorldTransformMatrix(), instance);
+            instance.tileIndex = renderer.GetTileIndex(node->getSprite()->GetTileMapPosition(), material);
+            instance.layer = layer;
+            SetSpriteInstancePalette(instance, node->GetPalette());
+
+            bounds.min = glm::min(bounds.min, node->gridBounds.min);
+            bounds.max = glm::max(bounds.max, node->gridBounds.max);
+        }
+
+        commands.push_back({renderer.GetQuadIndexCount(), static_cast<GLuint>(chunk.nodes.size()), 0, 0,
+                            firstInstance});
+        commandBounds.push_back(bounds);
+    }
+
+    isDirty = false;
+    return true;
+}
+
+float StaticSpriteBatch::GetDepth() const {
+    return depth;
+}
+
+uint8_t StaticSpriteBatch::GetRenderLayer() const {
+    return layer;
+}
+
+uint16_t StaticSpriteBatch::GetMaterial() const {
+    return material;
+}
+
+uint32_t StaticSpriteBatch::GetNodeCount() const {
+    return nodeCount;
+}
+
+uint32_t StaticSpriteBatch::GetChunkCount() const {
+    return static_cast<uint32_t>(chunks.size());
+}
+
+bool StaticSpriteBatch::IsEmpty() const {
+    return nodeCount == 0;
+}
+
+uint64_t StaticSpriteBatch::GetChunkKey(const SpriteNode *node) {
+    glm::vec2 center = (node->gridBounds.min + node->gridBounds.max) * 0.5f;
+    auto x = static_cast<int32_t>(std::floor(center.x / chunkSize));
+    auto y = static_cast<int32_t>(std::floor(center.y / chunkSize));
+    return (uint64_t(uint32_t(y)) << 32) | uint32_t(x);
+}
+
+BakedSpriteBatch::BakedSpriteBatch() : instanceBuffer(0), commandBuffer(0), material(0), layer(0) {
+    glGenBuffers(1, &instanceBuffer);
+    glGenBuffers(1, &commandBuffer);
+}
+
+BakedSpriteBatch::~BakedSpriteBatch() {
+    glDeleteBuffers(1, &instanceBuffer);
+    glDeleteBuffers(1, &commandBuffer);
+}
+
+void BakedSpriteBatch::Upload(const StaticBatchUpload &upload) {
+    material = upload.material;
+    layer = upload.renderLayer;
+    commandBounds = upload.commandBounds;
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, upload.instances.size() * sizeof(SpriteInstance), upload.instances.data(),
+                 GL_STATIC_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, upload.commands.size() * sizeof(DrawElementsIndirectCommand),
+                 upload.commands.data(), GL_STATIC_DRAW);
+}
+
+void BakedSpriteBatch::Draw(GLuint instanceBindingIndex, const Bounds2D *cullBounds) const {
+    if (commandBounds.empty())
+        return;
+
+    glBindVertexBuffer(instanceBindingIndex, instanceBuffer, 0, sizeof(SpriteInstance));
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+
+    if (cullBounds == nullptr) {
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr,
+                                    static_cast<GLsizei>(commandBounds.size()), 0);
+        return;
+    }
+
+    // Consecutive visible chunks share one call.
+    size_t runBegin = 0;
+    for (size_t i = 0; i <= commandBounds.size(); i++) {
+        if (i < commandBounds.size() && commandBounds[i].Overlaps(*cullBounds))
+            continue;
+
+        if (i > runBegin) {
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                                        reinterpret_cast<const void*>(runBegin * sizeof(DrawElementsIndirectCommand)),
+                                        static_cast<GLsizei>(i - runBegin), 0);
+        }
+        runBegin = i + 1;
+    }
+}
+
+uint16_t BakedSpriteBatch::GetMaterial() const {
+    return material;
+}
+
+uint8_t BakedSpriteBatch::GetRenderLayer() const {
+    return layer;
+}
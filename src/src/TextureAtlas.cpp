@@ -0,0 +1,334 @@
+#include "TextureAtlas.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stb_image.h>
+
+#include "LoggingMacros.h"
+
+namespace {
+    constexpr int componentCount = 4;
+
+    struct CookSource {
+        std::string name;
+        std::string path;
+        glm::ivec2 size;
+    };
+
+    // Uncompressed TGA with the origin at the bottom left, which matches the pixel order. Colour data is BGRA.
+    bool WriteTga(const std::string& path, glm::ivec2 size, const unsigned char* data, int bytesPerPixel) {
+        std::ofstream image(path, std::ios::binary);
+        if (!image) {
+            SPDLOG_ERROR("Failed to write atlas image: {}", path);
+            return false;
+        }
+
+        std::array<unsigned char, 18> header{};
+        header[2] = bytesPerPixel == 1 ? 3 : 2;
+        header[12] = static_cast<unsigned char>(size.x & 0xFF);
+        header[13] = static_cast<unsigned char>(size.x >> 8);
+        header[14] = static_cast<unsigned char>(size.y & 0xFF);
+        header[15] = static_cast<unsigned char>(size.y >> 8);
+        header[16] = static_cast<unsigned char>(bytesPerPixel * 8);
+        header[17] = bytesPerPixel == 4 ? 8 : 0;
+        image.write(reinterpret_cast<const char*>(header.data()), header.size());
+        image.write(reinterpret_cast<const char*>(data),
+                    static_cast<std::streamsize>(static_cast<size_t>(size.x) * size.y * bytesPerPixel));
+        return static_cast<bool>(image);
+    }
+
+    bool IsImageFile(const std::filesystem::path& path) {
+        std::string extension = path.extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char character) {
+            return static_cast<char>(std::tolower(character));
+        });
+        return extension == ".png" || extension == ".gif" || extension == ".tga" || extension == ".bmp"
+               || extension == ".jpg" || extension == ".jpeg";
+    }
+}
+
+TextureAtlas::TextureAtlas(glm::ivec2 size, int padding)
+        : size(size), padding(padding), pixels(static_cast<size_t>(size.x) * size.y * componentCount, 0),
+          packer(size) {}
+
+std::optional<uint16_t> TextureAtlas::AddImage(const std::string &name, const std::string &path) {
+    int width, height, fileComponentCount;
+    unsigned char* imageData = stbi_load(path.c_str(), &width, &height, &fileComponentCount, componentCount);
+    if (!imageData) {
+        SPDLOG_ERROR("Failed to load atlas image at path: {}", path);
+        return std::nullopt;
+    }
+
+    std::optional<uint16_t> region = AddPixels(name, imageData, glm::ivec2(width, height));
+    stbi_image_free(imageData);
+    return region;
+}
+
+std::optional<uint16_t> TextureAtlas::AddPixels(const std::string &name, const unsigned char *rgbaPixels,
+                                                glm::ivec2 imageSize) {
+    if (auto existing = FindRegion(name))
+        return existing;
+
+    if (regions.size() > UINT16_MAX) {
+        SPDLOG_ERROR("Too many regions in atlas, cannot add {}", name);
+        return std::nullopt;
+    }
+
+    // The padding keeps filtered samples of one region from picking up its neighbours.
+    std::optional<glm::ivec2> position = packer.Insert(imageSize + 2 * padding);
+    if (!position) {
+        SPDLOG_ERROR("No room left in atlas for {} ({}x{})", name, imageSize.x, imageSize.y);
+        return std::nullopt;
+    }
+
+    AtlasRegion& region = PlaceRegion(name, *position + padding, imageSize);
+    size_t rowBytes = static_cast<size_t>(imageSize.x) * componentCount;
+    for (int row = 0; row < imageSize.y; row++) {
+        size_t destination = (static_cast<size_t>(region.position.y + row) * size.x + region.position.x)
+                             * componentCount;
+        std::memcpy(pixels.data() + destination, rgbaPixels + row * rowBytes, rowBytes);
+    }
+    if (palette)
+        QuantizeRows(region.position.y, region.size.y);
+
+    return static_cast<uint16_t>(regions.size() - 1);
+}
+
+bool TextureAtlas::Save(const std::string &basePath) const {
+    std::vector<unsigned char> bgraPixels(pixels.size());
+    for (size_t i = 0; i < pixels.size(); i += componentCount) {
+        bgraPixels[i] = pixels[i + 2];
+        bgraPixels[i + 1] = pixels[i + 1];
+        bgraPixels[i + 2] = pixels[i];
+        bgraPixels[i + 3] = pixels[i + 3];
+    }
+    if (!WriteTga(basePath + ".tga", size, bgraPixels.data(), componentCount))
+        return false;
+    if (palette && !WriteTga(basePath + ".indexed.tga", size, indices.data(), 1))
+        return false;
+
+    std::ofstream table(basePath + ".atlas");
+    if (!table) {
+        SPDLOG_ERROR("Failed to write atlas table: {}.atlas", basePath);
+        return false;
+    }
+
+    table << "atlas " << size.x << ' ' << size.y << ' ' << padding << '\n';
+    if (palette) {
+        table << "palette";
+        for (size_t i = 1; i < palette->GetColors().size(); i++) {
+            const Palette::Color& color = palette->GetColors()[i];
+            table << " #" << std::hex << std::setfill('0');
+            for (uint8_t channel : color)
+                table << std::setw(2) << static_cast<int>(channel);
+            table << std::dec;
+        }
+        table << '\n';
+    }
+    for (const AtlasRegion &region : regions) {
+        table << region.position.x << ' ' << region.position.y << ' ' << region.size.x << ' ' << region.size.y << ' '
+              << region.uvRect.x << ' ' << region.uvRect.y << ' ' << region.uvRect.z << ' ' << region.uvRect.w << ' '
+              << region.name << '\n';
+    }
+
+    return static_cast<bool>(table);
+}
+
+bool TextureAtlas::Load(const std::string &basePath) {
+    std::ifstream table(basePath + ".atlas");
+    std::string line;
+    std::string tag;
+    glm::ivec2 tableSize;
+    int tablePadding;
+    if (!std::getline(table, line) || !(std::istringstream(line) >> tag >> tableSize.x >> tableSize.y >> tablePadding)
+        || tag != "atlas") {
+        SPDLOG_ERROR("Failed to read atlas table: {}.atlas", basePath);
+        return false;
+    }
+
+    int width, height, fileComponentCount;
+    unsigned char* imageData = stbi_load((basePath + ".tga").c_str(), &width, &height, &fileComponentCount,
+                                         componentCount);
+    if (!imageData || width != tableSize.x || height != tableSize.y) {
+        SPDLOG_ERROR("Failed to load atlas image: {}.tga", basePath);
+        stbi_image_free(imageData);
+        return false;
+    }
+
+    size = tableSize;
+    padding = tablePadding;
+    pixels.assign(imageData, imageData + static_cast<size_t>(width) * height * componentCount);
+    stbi_image_free(imageData);
+    packer = SkylinePacker(size);
+    regions.clear();
+    regionIndices.clear();
+    palette.reset();
+    indices.clear();
+
+    while (std::getline(table, line)) {
+        std::istringstream lineStream(line);
+        if (line.starts_with("palette")) {
+            if (!LoadIndices(basePath, lineStream))
+                return false;
+            continue;
+        }
+
+        glm::ivec2 position, regionSize;
+        glm::vec4 uvRect;
+        std::string name;
+        if (!(lineStream >> position.x >> position.y >> regionSize.x >> regionSize.y >> uvRect.x >> uvRect.y
+                         >> uvRect.z >> uvRect.w) || !std::getline(lineStream >> std::ws, name))
+            continue;
+
+        // Packing the same sizes in the same order rebuilds the skyline, so later regions go around these ones.
+        std::optional<glm::ivec2> packedPosition = packer.Insert(regionSize + 2 * padding);
+        if (!packedPosition || *packedPosition + padding != position)
+            SPDLOG_WARN("Atlas region {} does not match its packed position, late regions may overlap it", name);
+
+        PlaceRegion(name, position, regionSize);
+    }
+
+    return true;
+}
+
+void TextureAtlas::SetPalette(const Palette &newPalette) {
+    palette = newPalette;
+    indices.assign(static_cast<size_t>(size.x) * size.y, 0);
+    QuantizeRows(0, size.y);
+}
+
+bool TextureAtlas::IsIndexed() const {
+    return palette.has_value();
+}
+
+const Palette* TextureAtlas::GetPalette() const {
+    return palette ? &*palette : nullptr;
+}
+
+const uint8_t* TextureAtlas::GetIndices() const {
+    return indices.data();
+}
+
+std::optional<uint16_t> TextureAtlas::FindRegion(const std::string &name) const {
+    auto region = regionIndices.find(name);
+    if (region == regionIndices.end())
+        return std::nullopt;
+    return region->second;
+}
+
+const std::vector<AtlasRegion>& TextureAtlas::GetRegions() const {
+    return regions;
+}
+
+glm::ivec2 TextureAtlas::GetSize() const {
+    return size;
+}
+
+const unsigned char* TextureAtlas::GetPixels() const {
+    return pixels.data();
+}
+
+bool TextureAtlas::Cook(const std::string &sourceDirectory, const std::string &basePath, glm::ivec2 size,
+                        const Palette *palette) {
+    stbi_set_flip_vertically_on_load(true);
+
+    std::filesystem::path outputImage = std::filesystem::path(basePath + ".tga").lexically_normal();
+    std::error_code error;
+    std::filesystem::recursive_directory_iterator directory(sourceDirectory, error);
+    if (error) {
+        SPDLOG_ERROR("Failed to open atlas source directory: {}", sourceDirectory);
+        return false;
+    }
+
+    std::vector<CookSource> sources;
+    for (const auto& entry : directory) {
+        if (!entry.is_regular_file() || !IsImageFile(entry.path()) || entry.path().lexically_normal() == outputImage)
+            continue;
+
+        CookSource& source = sources.emplace_back();
+        source.path = entry.path().string();
+        source.name = std::filesystem::relative(entry.path(), sourceDirectory).replace_extension().generic_string();
+        int fileComponentCount;
+        if (!stbi_info(source.path.c_str(), &source.size.x, &source.size.y, &fileComponentCount)) {
+            SPDLOG_WARN("Skipping unreadable image: {}", source.path);
+            sources.pop_back();
+        }
+    }
+
+    // Tallest first keeps the skyline flat, the name only makes the order reproducible.
+    std::sort(sources.begin(), sources.end(), [](const CookSource &A, const CookSource &B) {
+        if (A.size.y != B.size.y)
+            return A.size.y > B.size.y;
+        return A.name < B.name;
+    });
+
+    TextureAtlas atlas(size);
+    if (palette != nullptr)
+        atlas.SetPalette(*palette);
+    for (const CookSource &source : sources) {
+        if (!atlas.AddImage(source.name, source.path))
+            return false;
+    }
+
+    if (!atlas.Save(basePath))
+        return false;
+
+    SPDLOG_INFO("Packed {} images into {}", sources.size(), outputImage.string());
+    return true;
+}
+
+void TextureAtlas::QuantizeRows(int firstRow, int rowCount) {
+    // The colour pixels are replaced by the palette colours, so both images show the same thing.
+    const std::vector<Palette::Color>& colors = palette->GetColors();
+    size_t begin = static_cast<size_t>(firstRow) * size.x;
+    size_t end = begin + static_cast<size_t>(rowCount) * size.x;
+    for (size_t i = begin; i < end; i++) {
+        unsigned char* texel = pixels.data() + i * componentCount;
+        indices[i] = palette->FindClosest(texel);
+        std::copy(colors[indices[i]].begin(), colors[indices[i]].end(), texel);
+    }
+}
+
+bool TextureAtlas::LoadIndices(const std::string &basePath, std::istringstream &paletteLine) {
+    Palette loadedPalette;
+    std::string tag;
+    std::string color;
+    paletteLine >> tag;
+    while (paletteLine >> color) {
+        auto value = static_cast<uint32_t>(std::strtoul(color.c_str() + 1, nullptr, 16));
+        loadedPalette.AddColor({static_cast<uint8_t>(value >> 24), static_cast<uint8_t>(value >> 16),
+                                static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value)});
+    }
+
+    int width, height, fileComponentCount;
+    unsigned char* indexData = stbi_load((basePath + ".indexed.tga").c_str(), &width, &height, &fileComponentCount, 1);
+    if (!indexData || width != size.x || height != size.y) {
+        SPDLOG_ERROR("Failed to load indexed atlas image: {}.indexed.tga", basePath);
+        stbi_image_free(indexData);
+        return false;
+    }
+
+    palette = std::move(loadedPalette);
+    indices.assign(indexData, indexData + static_cast<size_t>(width) * height);
+    stbi_image_free(indexData);
+    return true;
+}
+
+AtlasRegion& TextureAtlas::PlaceRegion(const std::string &name, glm::ivec2 position, glm::ivec2 regionSize) {
+    AtlasRegion& region = regions.emplace_back();
+    region.name = name;
+    region.position = position;
+    region.size = regionSize;
+    glm::vec2 atlasSize(size);
+    region.uvRect = glm::vec4(glm::vec2(position) / atlasSize, glm::vec2(position + regionSize) / atlasSize);
+
+    regionIndices[name] = static_cast<uint16_t>(regions.size() - 1);
+    return region;
+}
@@ -0,0 +1,139 @@
+#include "TileLayer.h"
+#include "TileMesh.h"
+
+#include <utility>
+
+TileLayer::TileLayer(glm::ivec2 size, std::vector<uint16_t> cells, const glm::mat4 *worldTransform, TileLayerMode mode)
+        : mode(mode), size(size), cells(std::move(cells)), worldTransform(worldTransform), renderLayer(0), id(0),
+          isUploaded(false) {
+}
+
+uint16_t TileLayer::PackCell(uint16_t tileIndex, uint8_t flags) {
+    return static_cast<uint16_t>((tileIndex & maxTileIndex) | (flags << flagsShift));
+}
+
+void TileLayer::SetCell(glm::ivec2 cell, uint16_t value) {
+    uint16_t& current = cells[cell.y * size.x + cell.x];
+    if (current == value)
+        return;
+
+    current = value;
+    if (isUploaded)
+        changedCells.push_back({cell, value});
+}
+
+bool TileLayer::TakeUpload(TileLayerUpload &upload) {
+    if (isUploaded && changedCells.empty())
+        return false;
+
+    upload.id = id;
+    upload.mode = mode;
+    upload.size = size;
+    upload.cells.clear();
+    upload.changedCells.clear();
+    if (!isUploaded)
+        upload.cells = cells;
+    else
+        std::swap(upload.changedCells, changedCells);
+
+    isUploaded = true;
+    return true;
+}
+
+TileLayerMode TileLayer::GetMode() const {
+    return mode;
+}
+
+glm::ivec2 TileLayer::GetSize() const {
+    return size;
+}
+
+const glm::mat4 &TileLayer::GetWorldTransform() const {
+    return *worldTransform;
+}
+
+float TileLayer::GetDepth() const {
+    return (*worldTransform)[3][2];
+}
+
+void TileLayer::SetRenderLayer(uint8_t layer) {
+    renderLayer = layer;
+}
+
+uint8_t TileLayer::GetRenderLayer() const {
+    return renderLayer;
+}
+
+uint32_t TileLayer::GetId() const {
+    return id;
+}
+
+void TileLayer::SetId(uint32_t newId) {
+    id = newId;
+}
+
+BakedTileLayer::BakedTileLayer() : mode(TileLayerMode::IndexTexture), indexTexture(0), size(0) {
+}
+
+BakedTileLayer::~BakedTileLayer() {
+    if (indexTexture != 0)
+        glDeleteTextures(1, &indexTexture);
+}
+
+void BakedTileLayer::Upload(const TileLayerUpload &upload, GlStateCache &stateCache) {
+    if (!upload.cells.empty()) {
+        mode = upload.mode;
+        size = upload.size;
+
+        if (mode == TileLayerMode::GreedyMesh) {
+            cells = upload.cells;
+            mesh = std::make_unique<TileMesh>(size);
+            mesh->Rebuild(cells, TileLayer::emptyCell, stateCache);
+            return;
+        }
+
+        glGenTextures(1, &indexTexture);
+        glBindTexture(GL_TEXTURE_2D, indexTexture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R16UI, size.x, size.y, 0, GL_RED_INTEGER, GL_UNSIGNED_SHORT,
+                     upload.cells.data());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        return;
+    }
+
+    if (mesh != nullptr) {
+        for (const TileCellChange& change : upload.changedCells) {
+            cells[change.cell.y * size.x + change.cell.x] = change.value;
+            mesh->MarkCellDirty(change.cell);
+        }
+        mesh->Rebuild(cells, TileLayer::emptyCell, stateCache);
+        return;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, indexTexture);
+    for (const TileCellChange& change : upload.changedCells) {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, change.cell.x, change.cell.y, 1, 1, GL_RED_INTEGER, GL_UNSIGNED_SHORT,
+                        &change.value);
+    }
+}
+
+TileLayerMode BakedTileLayer::GetMode() const {
+    return mode;
+}
+
+const TileMesh *BakedTileLayer::GetMesh() const {
+    return mesh.get();
+}
+
+GLuint BakedTileLayer::GetIndexTexture() const {
+    return indexTexture;
+}
+
+glm::ivec2 BakedTileLayer::GetSize() const {
+    return size;
+}
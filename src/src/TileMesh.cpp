@@ -0,0 +1,137 @@
+#include "TileMesh.h"
+
+#include <cstddef>
+
+#include "GlStateCache.h"
+
+TileMesh::TileMesh(glm::ivec2 size)
+        : size(size), chunkCount((size + chunkSize - 1) / chunkSize), quadCount(0), hasDirtyChunks(true) {
+    chunks.resize(chunkCount.x * chunkCount.y, Chunk{0, 0, 0, true});
+}
+
+TileMesh::~TileMesh() {
+    for (Chunk& chunk : chunks) {
+        if (chunk.vao == 0)
+            continue;
+
+        glDeleteVertexArrays(1, &chunk.vao);
+        glDeleteBuffers(1, &chunk.vbo);
+    }
+}
+
+void TileMesh::AllocateChunk(Chunk &chunk, GlStateCache &stateCache) {
+    glGenVertexArrays(1, &chunk.vao);
+    glGenBuffers(1, &chunk.vbo);
+
+    stateCache.BindVertexArray(chunk.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, chunk.vbo);
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(TileMeshVertex),
+                          (void*) offsetof(TileMeshVertex, cellPosition));
+    glEnableVertexAttribArray(1);
+    glVertexAttribIPointer(1, 1, GL_UNSIGNED_SHORT, sizeof(TileMeshVertex), (void*) offsetof(TileMeshVertex, cell));
+}
+
+void TileMesh::MarkCellDirty(glm::ivec2 cell) {
+    glm::ivec2 chunk = cell / chunkSize;
+    chunks[chunk.y * chunkCount.x + chunk.x].isDirty = true;
+    hasDirtyChunks = true;
+}
+
+void TileMesh::Rebuild(const std::vector<uint16_t> &cells, uint16_t emptyCell, GlStateCache &stateCache) {
+    if (!hasDirtyChunks)
+        return;
+
+    std::vector<TileMeshVertex> vertices;
+
+    for (int chunkY = 0; chunkY < chunkCount.y; chunkY++) {
+        for (int chunkX = 0; chunkX < chunkCount.x; chunkX++) {
+            Chunk& chunk = chunks[chunkY * chunkCount.x + chunkX];
+            if (!chunk.isDirty)
+                continue;
+
+            glm::ivec2 origin(chunkX * chunkSize, chunkY * chunkSize);
+            glm::ivec2 extent = glm::min(glm::ivec2(chunkSize), size - origin);
+
+            vertices.clear();
+            MergeCells(cells, size, origin, extent, emptyCell, vertices);
+
+            quadCount -= chunk.vertexCount / 6;
+            chunk.vertexCount = static_cast<GLsizei>(vertices.size());
+            quadCount += chunk.vertexCount / 6;
+            chunk.isDirty = false;
+
+            // An emptied chunk keeps its objects and is skipped by Draw(), refilling it is likely.
+            if (vertices.empty())
+                continue;
+            if (chunk.vao == 0)
+                AllocateChunk(chunk, stateCache);
+
+            glBindBuffer(GL_ARRAY_BUFFER, chunk.vbo);
+            glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(TileMeshVertex), vertices.data(), GL_STATIC_DRAW);
+        }
+    }
+    hasDirtyChunks = false;
+}
+
+void TileMesh::Draw(GlStateCache &stateCache) const {
+    for (const Chunk& chunk : chunks) {
+        if (chunk.vertexCount == 0)
+            continue;
+
+        stateCache.BindVertexArray(chunk.vao);
+        glDrawArrays(GL_TRIANGLES, 0, chunk.vertexCount);
+    }
+}
+
+uint32_t TileMesh::GetQuadCount() const {
+    return quadCount;
+}
+
+void TileMesh::MergeCells(const std::vector<uint16_t> &cells, glm::ivec2 size, glm::ivec2 origin, glm::ivec2 extent,
+                          uint16_t emptyCell, std::vector<TileMeshVertex> &vertices) {
+    std::vector<bool> isMerged(extent.x * extent.y, false);
+    auto cellAt = [&](int x, int y) {
+        return cells[(origin.y + y) * size.x + origin.x + x];
+    };
+
+    for (int y = 0; y < extent.y; y++) {
+        for (int x = 0; x < extent.x; x++) {
+            uint16_t cell = cellAt(x, y);
+            if (cell == emptyCell || isMerged[y * extent.x + x])
+                continue;
+
+            int width = 1;
+            while (x + width < extent.x && !isMerged[y * extent.x + x + width] && cellAt(x + width, y) == cell)
+                width++;
+
+            int height = 1;
+            for (bool canGrow = true; canGrow && y + height < extent.y; ) {
+                for (int column = x; column < x + width; column++) {
+                    if (isMerged[(y + height) * extent.x + column] || cellAt(column, y + height) != cell) {
+                        canGrow = false;
+                        break;
+                    }
+                }
+                if (canGrow)
+                    height++;
+            }
+
+            for (int row = y; row < y + height; row++) {
+                for (int column = x; column < x + width; column++)
+                    isMerged[row * extent.x + column] = true;
+            }
+
+            glm::vec2 topLeft(origin.x + x, origin.y + y);
+            glm::vec2 bottomRight = topLeft + glm::vec2(width, height);
+            TileMeshVertex corners[4] = {
+                    {topLeft, cell, 0},
+                    {{bottomRight.x, topLeft.y}, cell, 0},
+                    {bottomRight, cell, 0},
+                    {{topLeft.x, bottomRight.y}, cell, 0},
+            };
+            vertices.insert(vertices.end(), {corners[0], corners[1], corners[3], corners[1], corners[2], corners[3]});
+        }
+    }
+}
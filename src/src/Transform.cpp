@@ -22,23 +22,28 @@ glm::vec3 Transform::GetScale() const {
 
 void Transform::SetPosition(const glm::vec3& newPosition) {
     position = newPosition;
-    isDirty = true;
+    version++;
 }
 
 void Transform::SetScale(const glm::vec3& newScale) {
     scale = newScale;
-    isDirty = true;
+    version++;
 }
 
-Transform::Transform() : position(glm::vec3(0.f)), rotation(glm::mat4(1.f)), scale(glm::vec3(1.f)), isDirty(true) {}
+Transform::Transform() : position(glm::vec3(0.f)), rotation(glm::mat4(1.f)), scale(glm::vec3(1.f)), version(0) {}
 
 Transform::Transform(Transform* originalTransform) :
         position(originalTransform->position),
         rotation(originalTransform->rotation),
-        scale(originalTransform->scale) {
+        scale(originalTransform->scale),
+        version(originalTransform->version) {
+}
+
+uint32_t Transform::GetVersion() const {
+    return version;
 }
 
 void Transform::SetRotation(const glm::quat &newRotation) {
     rotation = newRotation;
-    isDirty = true;
+    version++;
 }
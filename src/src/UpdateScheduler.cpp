@@ -0,0 +1,18 @@
+#include "UpdateScheduler.h"
+
+void UpdateScheduler::Run(MainEngine* engine, float seconds, float deltaSeconds) {
+    // Indexed, an update method may register the first node of a new list and grow the phase.
+    for (auto& phase : phases) {
+        for (size_t i = 0; i < phase.size(); i++) {
+            phase[i]->Run(engine, seconds, deltaSeconds);
+        }
+    }
+}
+
+void UpdateScheduler::Compact() {
+    for (auto& phase : phases) {
+        for (auto& list : phase) {
+            list->Compact();
+        }
+    }
+}